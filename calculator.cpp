@@ -1,470 +1,8691 @@
-#include <iostream>
-#include <string>
-#include <cmath>
-#include <limits>
-using namespace std;
-
-#define MAX_OPERATORS 16
-
-void throwException(const char* message)
-{
-	cerr << message << endl;
-	terminate();
-}
-
-int strlen(const char* str)
-{
-	int i = 0;
-	while(str[i] != '\0')
-	{
-		i++;
-	}
-	return i;
-}
-
-class Operation
-{
-protected:
-	string name;
-	string symbol;
-
-	void assertValidity()
-	{
-		if(name.empty()) throwException("Invalid operation name!");
-		if(symbol.empty()) throwException("Invalid operation symbol!");
-	}
-
-	void copyFrom(string name, string symbol)
-	{
-		this->name = name;
-		this->symbol = symbol;
-		assertValidity();
-	}
-
-public:
-	Operation(string name, string symbol)
-	{
-		copyFrom(name, symbol);
-	}
-
-	Operation(const Operation &other)
-	{
-		copyFrom(other.name, other.symbol);
-	}
-
-	Operation& operator=(const Operation &other)
-	{
-		if(this != &other)
-		{
-			copyFrom(other.name, other.symbol);
-		}
-		return *this;
-	}
-
-	virtual Operation* createNew() const = 0;
-
-	virtual double execute(const double n1, const double n2) = 0;
-
-	string getName() const
-	{
-		return name;
-	}
-
-	string getSymbol() const
-	{
-		return symbol;
-	}
-
-	void setName(const string name)
-	{
-		this->name = name;
-		assertValidity();
-	}
-
-	void setSymbol(const string symbol)
-	{
-		this->symbol = symbol;
-		assertValidity();
-	}
-};
-
-class AddOperation: public Operation
-{
-public:
-	AddOperation(): Operation("Add", "+") {};
-
-	AddOperation(const AddOperation &other): Operation(other) {};
-
-	AddOperation& operator=(const AddOperation &other)
-	{
-		Operation::operator=(other);
-		return *this;
-	}
-
-	AddOperation* createNew() const override
-	{
-		return new AddOperation(*this);
-	}
-
-	double execute(const double n1, const double n2) override
-	{
-		return n1 + n2;
-	}
-};
-
-class SubtractOperation: public Operation
-{
-public:
-	SubtractOperation(): Operation("Subtract", "-") {};
-
-	SubtractOperation(const SubtractOperation &other): Operation(other) {};
-
-	SubtractOperation& operator=(const SubtractOperation &other)
-	{
-		Operation::operator=(other);
-		return *this;
-	}
-
-	SubtractOperation* createNew() const override
-	{
-		return new SubtractOperation(*this);
-	}
-	
-	double execute(const double n1, const double n2) override
-	{
-		return n1 - n2;
-	}
-};
-
-class MultiplyOperation: public Operation
-{
-public:
-	MultiplyOperation(): Operation("Multiply", "*") {};
-
-	MultiplyOperation(const MultiplyOperation &other): Operation(other) {};
-
-	MultiplyOperation& operator=(const MultiplyOperation &other)
-	{
-		Operation::operator=(other);
-		return *this;
-	}
-
-	MultiplyOperation* createNew() const override
-	{
-		return new MultiplyOperation(*this);
-	}
-
-	double execute(const double n1, const double n2) override
-	{
-		return n1 * n2;
-	}
-};
-
-class DivideOperation: public Operation
-{
-public:
-	DivideOperation(): Operation("Divide", "/") {};
-
-	DivideOperation(const DivideOperation &other): Operation(other) {};
-
-	DivideOperation& operator=(const DivideOperation &other)
-	{
-		Operation::operator=(other);
-		return *this;
-	}
-
-	DivideOperation* createNew() const override
-	{
-		return new DivideOperation(*this);
-	}
-
-	double execute(const double n1, const double n2) override
-	{
-		if(n2 == 0) throwException("Cannot divide by zero!");
-		return n1 / n2;
-	}
-};
-
-class PowerOperation: public Operation
-{
-public:
-	PowerOperation(): Operation("Power", "**") {};
-
-	PowerOperation(const PowerOperation &other): Operation(other) {};
-
-	PowerOperation& operator=(const PowerOperation &other)
-	{
-		Operation::operator=(other);
-		return *this;
-	}
-
-	PowerOperation* createNew() const override
-	{
-		return new PowerOperation(*this);
-	}
-
-	double execute(const double n1, const double n2) override
-	{
-		if(n1 == 0 && n2 == 0) throwException("Cannot raise 0 to the power of 0!");
-		return pow(n1, n2);
-	}
-};
-
-class RootOperation: public Operation
-{
-public:
-	RootOperation(): Operation("Root", "V") {};
-
-	RootOperation(const RootOperation &other): Operation(other) {};
-
-	RootOperation& operator=(const RootOperation &other)
-	{
-		Operation::operator=(other);
-		return *this;
-	}
-
-	RootOperation* createNew() const override
-	{
-		return new RootOperation(*this);
-	}
-
-	double execute(const double n1, const double n2) override
-	{
-		if(n1 < 0 && n2 < 0) throwException("Cannot take negative root of negative number!");
-		if(n1 < 0 && (int)n2 != n2) throwException("Cannot take fractional root of negative number");
-		return pow(n1, 1 / n2);
-	}
-};
-
-class Calculator
-{
-protected:
-	const char* name;
-	size_t numberOfSupportedOperations;
-	size_t capacityForOperations;
-	Operation **operations;
-	static double numberOfSuccessfulCalculations;
-
-	void assertValidity()
-	{
-		if(name == nullptr || strlen(name) == 0) throwException("Invalid calculator name!");
-		if(capacityForOperations == 0) throwException("Capacity for operations cannot be zero!");
-	}
-
-	void copyFrom(const char* name, size_t numberOfSupportedOperations, size_t capacityForOperations, Operation **operations)
-	{
-		this->name = name;
-		this->numberOfSupportedOperations = numberOfSupportedOperations;
-		this->capacityForOperations = capacityForOperations;
-		this->operations = new Operation*[capacityForOperations];
-		for(size_t i = 0; i < numberOfSupportedOperations; i++)
-		{
-			this->operations[i] = operations[i];
-		}
-		assertValidity();
-	}
-
-	double calculate(double n1, double n2, string op) const
-	{
-		for(int i = 0; i < numberOfSupportedOperations; i++)
-		{
-			if(operations[i]->getSymbol() == op) return operations[i]->execute(n1, n2);
-		}
-		return 0;
-	}
-
-public:
-	Calculator()
-	{
-		char* buffer = new char[1];
-		buffer[0] = '\0';
-		name = buffer;
-		operations = new Operation*[2];
-		numberOfSupportedOperations = 0;
-		capacityForOperations = 2;
-		assertValidity();
-	}
-
-	Calculator(const char* name, size_t n, Operation** ops)
-	{
-		copyFrom(name, n, MAX_OPERATORS, ops);
-	}
-
-	Calculator(const Calculator& other)
-	{
-		copyFrom(other.name, other.numberOfSupportedOperations, other.capacityForOperations, other.operations);
-	}
-
-	const Calculator& operator=(const Calculator& other)
-	{
-		if(this != &other)
-		{
-			delete[] name;
-			delete[] operations;
-			copyFrom(other.name, other.numberOfSupportedOperations, other.capacityForOperations, other.operations);
-		}
-		return *this;
-	}
-
-	~Calculator()
-	{
-		delete[] name;
-		delete[] operations;
-	}
-
-	void listSupportedOperations() const
-	{
-		for(size_t i = 0; i < numberOfSupportedOperations; i++)
-		{
-			cout << operations[i]->getSymbol() << " - " << operations[i]->getName() << endl;
-		}
-	}
-
-	void listInputFormat() const
-	{
-		cout << "<num1> <symbol> <num2> <symbol> <num3> ... <numN> =" << endl;
-		cout << "Please make sure to include spaces between each number and operator." << endl;
-	}
-
-	Calculator& addOperation(const Operation* op)
-	{
-		if(numberOfSupportedOperations == capacityForOperations) throwException("Capacity for operations exceeded!");
-		operations[numberOfSupportedOperations++] = op->createNew();
-		return *new Calculator();
-	}
-
-	void startCalculation() const
-	{
-		double result;
-		double num2;
-		string op;
-		cin >> result;
-		while(true)
-		{
-			cin >> op;
-			if(op == "=") break;
-			cin >> num2;
-			result = calculate(result, num2, op);
-		}
-		numberOfSuccessfulCalculations++;
-		cout << result << endl;
-	}
-
-	double getNumberOfSuccessfulCalculations() const
-	{
-		return numberOfSuccessfulCalculations;
-	}
-};
-
-double Calculator::numberOfSuccessfulCalculations = 0;
-
-Operation* createOperation(string operationSymbol)
-{
-	if(operationSymbol == "+") return new AddOperation();
-	if(operationSymbol == "-") return new SubtractOperation();
-	if(operationSymbol == "*") return new MultiplyOperation();
-	if(operationSymbol == "/") return new DivideOperation();
-	if(operationSymbol == "**") return new PowerOperation();
-	if(operationSymbol == "V") return new RootOperation();
-	throwException("Invalid operator!");
-	return new AddOperation(); // So that the compiler doesn't complain...
-}
-
-int main()
-{
-	cout << "Enter calculator's name: ";
-	char* calculatorName = new char[256];
-	cin.getline(calculatorName, 256);
-	size_t numberOfOperations;
-	do
-	{
-		cout << "Enter number of operations: ";
-		cin >> numberOfOperations;
-		if(cin.fail())
-		{
-			cout << "Couldn't convert to number!" << endl;
-			
-		}
-		else if(numberOfOperations > MAX_OPERATORS)
-		{
-			cout << "Exceeded operator capacity of " << MAX_OPERATORS << "!" << endl;
-		}
-		else break;
-		cin.clear();
-		cin.ignore(numeric_limits<streamsize>::max(), '\n');
-	} while(true);
-	
-	cout << "Enter operations: " << endl;
-	cout << "+ - add" << endl;
-	cout << "- - subtract" << endl;
-	cout << "* - multiply" << endl;
-	cout << "/ - divide" << endl;
-	cout << "** - power" << endl;
-	cout << "V - root" << endl;
-	string* operationList = new string[MAX_OPERATORS];
-	while(true)
-	{
-		string operationSymbol;
-		bool valid = true;
-		for(int i = 0; i < numberOfOperations; i++)
-		{
-			cin >> operationSymbol;
-			if(operationSymbol == "+" || operationSymbol == "-" || operationSymbol == "*" || operationSymbol == "/" || operationSymbol == "**" || operationSymbol == "V")
-			{
-				operationList[i] = operationSymbol;
-			}
-			else
-			{
-				cout << "Invalid operator!" << endl;
-				valid = false;
-				break;
-			}
-		}
-		cin.clear();
-		cin.ignore(numeric_limits<streamsize>::max(), '\n');
-		if(valid) break;
-	}
-	
-	Operation** ops = new Operation*[MAX_OPERATORS];
-	for(int i = 0; i < numberOfOperations; i++)
-	{
-		ops[i] = createOperation(operationList[i]);
-	}
-	Calculator* calc = new Calculator(calculatorName, numberOfOperations, ops);
-	while(true)
-	{
-		cout << "1. List supported operations" << endl;
-		cout << "2. List input format" << endl;
-		cout << "3. Start calculation" << endl;
-		cout << "4. Exit" << endl;
-		short chosenOption;
-		cin >> chosenOption;
-		switch(chosenOption)
-		{
-		case 1:
-			calc->listSupportedOperations();
-			break;
-		case 2:
-			calc->listInputFormat();
-			break;
-		case 3:
-			calc->startCalculation();
-			break;
-		case 4:
-			break;
-		default:
-			cout << "Invalid option, try again." << endl;
-			cin.clear();
-			cin.ignore(numeric_limits<streamsize>::max(), '\n');
-		}
-		if(chosenOption == 4) break;
-	}
-	delete[] calculatorName;
-	delete calc;
-	for (int i = 0; i < numberOfOperations; ++i)
-	{
-    	delete ops[i];
-	}
-	delete[] ops;
-	return 0;
-}
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <cctype>
+#include <limits>
+#include <new>
+#include <charconv>
+#include <system_error>
+#include <vector>
+#include <map>
+#include <memory>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <cerrno>
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <csignal>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <netdb.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#if defined(__x86_64__) && defined(__linux__) && !defined(CALCULATOR_NO_JIT)
+#define CALCULATOR_JIT
+#endif
+#if defined(__linux__) && !defined(CALCULATOR_NO_OPENCL)
+#define CALCULATOR_OPENCL
+#endif
+#if __cplusplus >= 202002L && __has_include(<coroutine>)
+#include <coroutine>
+#define CALCULATOR_COROUTINES
+#endif
+using namespace std;
+
+#define INLINE_OPERATION_SLOTS 16
+#define OPERATION_CHUNK_SLOTS 16
+#define CALCULATOR_PLUGIN_ABI_VERSION 1
+#define CALCULATOR_PLUGIN_ENTRY "calculatorPlugin"
+#define MAX_NAME_LENGTH 255
+#define OPERATION_SLOT_SIZE 128
+#define BATCH_OUTPUT_BUFFER_SIZE (1 << 20)
+#define BATCH_INPUT_BLOCK_SIZE (16 << 20)
+#define BATCH_CHUNK_SIZE (1 << 20)
+#define COLUMNAR_MAGIC "CCOL"
+#define COLUMNAR_VERSION 1
+#define TAPE_CACHE_MAGIC "CTAP"
+#define TAPE_CACHE_VERSION 4
+#define COLUMNAR_GROUP_ROWS (1 << 16)
+#define COLUMNAR_MAX_GROUP_ROWS (1 << 24)
+#define COUNTER_SHARDS 64
+#define CACHE_LINE_SIZE 64
+#define NUMBER_OF_STATUS_FLAGS 8
+#define SERVER_MAX_EVENTS 256
+#define SERVER_READ_SIZE (64 << 10)
+#define SERVER_MAX_REQUEST_SIZE (1 << 20)
+#define SERVER_MAX_PENDING_OUTPUT (4 << 20)
+#define DISPATCH_TABLE_SIZE 256
+#define MAX_STACK_DEPTH 64
+#define MAX_SAVED_VALUES 64
+#define CACHE_SHARDS 16
+#define HISTOGRAM_SUB_BUCKETS 16
+#define QUANTILE_SKETCH_BITS 7
+#define HISTOGRAM_BUCKETS (HISTOGRAM_SUB_BUCKETS * 40)
+#define LATENCY_SAMPLE_INTERVAL 64
+#define NUMBER_OF_METERED_OPCODES (OPCODE_CALL - OPCODE_ADD + 1)
+#define COLUMN_BLOCK_SIZE 512
+#define COLUMN_RUN_LENGTH 16
+#define VECTOR_WIDTH 8
+#define POWER_SQUARING_LIMIT 4
+#define BENCHMARK_REPETITIONS 31
+#define BENCHMARK_OPERANDS 4096
+#define FORMULA_GRAPH_PARALLEL_NODES 256
+#define FORMULA_GRAPH_TASK_NODES 64
+#define FIXED_POINT_DECIMALS 6
+#define DECIMAL128_DIGITS 34
+#define DECIMAL128_MAX_EXPONENT 6111
+#define DECIMAL128_MIN_EXPONENT -6176
+#define DECIMAL128_COEFFICIENT_LIMIT ((unsigned __int128)10000000000000000ULL * 1000000000000000000ULL)
+#define DECIMAL128_ALIGNMENT_DIGITS (2 * DECIMAL128_DIGITS + 4)
+#define DECIMAL_EXPONENT_LIMIT 1000000000LL
+#define DECIMAL_PLAIN_DIGITS 40
+#define DECIMAL_PLAIN_ZEROS 7
+#define BIG_LIMB_BASE 1000000000U
+#define BIG_LIMB_DIGITS 9
+#define BIG_INLINE_LIMBS 8
+#define BIG_INTEGER_DIGITS 18
+#define BIG_DECIMAL_MAX_DIGITS 10000
+#define BIG_DECIMAL_DIVISION_DIGITS 50
+#define JIT_THRESHOLD 1024
+#define JIT_REGISTERS 14
+#define JIT_COLUMN_INSTRUCTIONS 5
+#define DISTRIBUTED_SHARD_SIZE (1 << 20)
+#define DISTRIBUTED_SHARDS_PER_WORKER 2
+#define DISTRIBUTED_WINDOW_SHARDS 256
+#define DISTRIBUTED_MAX_ATTEMPTS 3
+#define DISTRIBUTED_RETRY_MILLISECONDS 500
+#define DISTRIBUTED_TIMEOUT_MILLISECONDS 30000
+#define DISTRIBUTED_POLL_MILLISECONDS 100
+#define OPENCL_MAX_PLATFORMS 8
+#define OPENCL_MAX_DEVICES 16
+#define OPENCL_MIN_ROWS (1 << 16)
+#define OPENCL_WORK_GROUP_SIZE 64
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define SIMD_DISPATCH __attribute__((target_clones("avx512f", "avx2", "default")))
+#define FMA_DISPATCH __attribute__((target_clones("avx512f", "fma", "default")))
+#else
+#define SIMD_DISPATCH
+#define FMA_DISPATCH
+#endif
+
+typedef double DoubleVector __attribute__((vector_size(VECTOR_WIDTH * sizeof(double)), aligned(sizeof(double))));
+typedef long long MaskVector __attribute__((vector_size(VECTOR_WIDTH * sizeof(long long)), aligned(sizeof(long long))));
+typedef unsigned char StatusVector __attribute__((vector_size(VECTOR_WIDTH), aligned(1)));
+
+enum Opcode: unsigned char
+{
+	OPCODE_LOAD_CONSTANT,
+	OPCODE_LOAD_VARIABLE,
+	OPCODE_ADD,
+	OPCODE_SUBTRACT,
+	OPCODE_MULTIPLY,
+	OPCODE_DIVIDE,
+	OPCODE_POWER,
+	OPCODE_ROOT,
+	OPCODE_CALL,
+	OPCODE_STORE,
+	OPCODE_LOAD_SAVED,
+	OPCODE_POWER_CONSTANT,
+	OPCODE_MULTIPLY_ADD,
+	OPCODE_MULTIPLY_SUBTRACT,
+	OPCODE_ADD_MULTIPLY,
+	OPCODE_SUBTRACT_MULTIPLY
+};
+
+struct Instruction
+{
+	unsigned char opcode;
+	unsigned short operand;
+};
+
+void throwException(const char* message)
+{
+	cerr << message << endl;
+	terminate();
+}
+
+enum CalculationStatus: unsigned char
+{
+	STATUS_OK = 0,
+	STATUS_DIVIDE_BY_ZERO = 1,
+	STATUS_ZERO_TO_POWER_OF_ZERO = 2,
+	STATUS_NEGATIVE_ROOT_OF_NEGATIVE = 4,
+	STATUS_FRACTIONAL_ROOT_OF_NEGATIVE = 8,
+	STATUS_INVALID_OPERATOR = 16,
+	STATUS_INVALID_EXPRESSION = 32,
+	STATUS_OVERFLOW = 64,
+	STATUS_NOT_EXACT = 128
+};
+
+constexpr inline const char* describeStatus(unsigned char status)
+{
+	if(status & STATUS_DIVIDE_BY_ZERO) return "Cannot divide by zero!";
+	if(status & STATUS_ZERO_TO_POWER_OF_ZERO) return "Cannot raise 0 to the power of 0!";
+	if(status & STATUS_NEGATIVE_ROOT_OF_NEGATIVE) return "Cannot take negative root of negative number!";
+	if(status & STATUS_FRACTIONAL_ROOT_OF_NEGATIVE) return "Cannot take fractional root of negative number";
+	if(status & STATUS_INVALID_OPERATOR) return "Invalid operator!";
+	if(status & STATUS_INVALID_EXPRESSION) return "Invalid expression!";
+	if(status & STATUS_OVERFLOW) return "Result is out of range!";
+	if(status & STATUS_NOT_EXACT) return "Result cannot be represented exactly!";
+	return "";
+}
+
+inline void assertSuccess(unsigned char status)
+{
+	if(status != STATUS_OK) throwException(describeStatus(status));
+}
+
+constexpr inline double addNumbers(const double n1, const double n2)
+{
+	return n1 + n2;
+}
+
+constexpr inline double subtractNumbers(const double n1, const double n2)
+{
+	return n1 - n2;
+}
+
+constexpr inline double multiplyNumbers(const double n1, const double n2)
+{
+	return n1 * n2;
+}
+
+constexpr inline double divideNumbers(const double n1, const double n2, unsigned char& status)
+{
+	status |= (n2 == 0) * STATUS_DIVIDE_BY_ZERO;
+	return n2 == 0 ? numeric_limits<double>::quiet_NaN() : n1 / n2;
+}
+
+constexpr inline double integerPower(double base, unsigned exponent)
+{
+	double result = 1;
+	while(exponent != 0)
+	{
+		if(exponent & 1) result *= base;
+		exponent >>= 1;
+		if(exponent != 0) base *= base;
+	}
+	return result;
+}
+
+inline bool isSmallInteger(const double n)
+{
+	return n >= -POWER_SQUARING_LIMIT && n <= POWER_SQUARING_LIMIT && (int)n == n;
+}
+
+// The only exponents whose squaring chain gives exactly what pow() gives:
+// glibc's pow() is not correctly rounded even for 2 and -1, where n * n
+// and 1 / n are. Any longer chain needs fastMath.
+inline bool isExactIntegerPower(const double n)
+{
+	return n == 0 || n == 1;
+}
+
+inline double signedIntegerPower(const double n1, const int n2)
+{
+	return n2 < 0 ? 1 / integerPower(n1, -n2) : integerPower(n1, n2);
+}
+
+inline double powerNumbers(const double n1, const double n2, unsigned char& status)
+{
+	bool invalid = n1 == 0 && n2 == 0;
+	status |= invalid * STATUS_ZERO_TO_POWER_OF_ZERO;
+	if(invalid) return numeric_limits<double>::quiet_NaN();
+	return isExactIntegerPower(n2) ? signedIntegerPower(n1, (int)n2) : pow(n1, n2);
+}
+
+inline double rootNumbers(const double n1, const double n2, unsigned char& status)
+{
+	bool negativeRoot = n1 < 0 && n2 < 0;
+	bool fractionalRoot = n1 < 0 && (int)n2 != n2;
+	status |= negativeRoot * STATUS_NEGATIVE_ROOT_OF_NEGATIVE | fractionalRoot * STATUS_FRACTIONAL_ROOT_OF_NEGATIVE;
+	if(negativeRoot || fractionalRoot) return numeric_limits<double>::quiet_NaN();
+	if(n1 > 0 && n2 == 2) return sqrt(n1);
+	if(n1 > 0 && n2 == 3) return cbrt(n1);
+	return pow(n1, 1 / n2);
+}
+
+constexpr inline double divideNumbers(const double n1, const double n2)
+{
+	if(n2 == 0) throwException(describeStatus(STATUS_DIVIDE_BY_ZERO));
+	return n1 / n2;
+}
+
+inline double powerNumbers(const double n1, const double n2)
+{
+	unsigned char status = STATUS_OK;
+	double result = powerNumbers(n1, n2, status);
+	assertSuccess(status);
+	return result;
+}
+
+inline double rootNumbers(const double n1, const double n2)
+{
+	unsigned char status = STATUS_OK;
+	double result = rootNumbers(n1, n2, status);
+	assertSuccess(status);
+	return result;
+}
+
+inline double applyOpcode(const unsigned char opcode, const double n1, const double n2, unsigned char& status)
+{
+	switch(opcode)
+	{
+	case OPCODE_ADD:
+		return addNumbers(n1, n2);
+	case OPCODE_SUBTRACT:
+		return subtractNumbers(n1, n2);
+	case OPCODE_MULTIPLY:
+		return multiplyNumbers(n1, n2);
+	case OPCODE_DIVIDE:
+		return divideNumbers(n1, n2, status);
+	case OPCODE_POWER:
+		return powerNumbers(n1, n2, status);
+	case OPCODE_ROOT:
+		return rootNumbers(n1, n2, status);
+	}
+	status |= STATUS_INVALID_OPERATOR;
+	return numeric_limits<double>::quiet_NaN();
+}
+
+#define DEFINE_COLUMN_KERNEL(functionName, expression) \
+	SIMD_DISPATCH void functionName(const double* a, const double* b, double* out, unsigned char*, size_t n) \
+	{ \
+		size_t i = 0; \
+		for(; i + VECTOR_WIDTH <= n; i += VECTOR_WIDTH) \
+		{ \
+			DoubleVector x = *(const DoubleVector*)(a + i); \
+			DoubleVector y = *(const DoubleVector*)(b + i); \
+			*(DoubleVector*)(out + i) = expression; \
+		} \
+		for(; i < n; i++) \
+		{ \
+			double x = a[i]; \
+			double y = b[i]; \
+			out[i] = expression; \
+		} \
+	}
+
+DEFINE_COLUMN_KERNEL(addColumns, x + y)
+DEFINE_COLUMN_KERNEL(subtractColumns, x - y)
+DEFINE_COLUMN_KERNEL(multiplyColumns, x * y)
+
+// Applies the same operation left to right across a run of operands in one
+// pass, keeping the running value in registers instead of writing a scratch
+// column per step. A null operand stands for the matching scalar.
+#define DEFINE_RUN_KERNEL(functionName, expression) \
+	SIMD_DISPATCH void functionName(const double* a, const double* const* operands, const double* scalars, size_t k, double* out, size_t n) \
+	{ \
+		size_t i = 0; \
+		for(; i + VECTOR_WIDTH <= n; i += VECTOR_WIDTH) \
+		{ \
+			DoubleVector x = *(const DoubleVector*)(a + i); \
+			for(size_t t = 0; t < k; t++) \
+			{ \
+				DoubleVector y = operands[t] != nullptr ? *(const DoubleVector*)(operands[t] + i) : DoubleVector{} + scalars[t]; \
+				x = expression; \
+			} \
+			*(DoubleVector*)(out + i) = x; \
+		} \
+		for(; i < n; i++) \
+		{ \
+			double x = a[i]; \
+			for(size_t t = 0; t < k; t++) \
+			{ \
+				double y = operands[t] != nullptr ? operands[t][i] : scalars[t]; \
+				x = expression; \
+			} \
+			out[i] = x; \
+		} \
+	}
+
+DEFINE_RUN_KERNEL(addRunColumns, x + y)
+DEFINE_RUN_KERNEL(subtractRunColumns, x - y)
+DEFINE_RUN_KERNEL(multiplyRunColumns, x * y)
+
+// Each lane is an explicit fma(), which the vectorizer turns into packed
+// FMA instructions where the target has them.
+#define DEFINE_FUSED_KERNEL(functionName, expression) \
+	FMA_DISPATCH void functionName(const double* a, const double* b, const double* c, double* out, size_t n) \
+	{ \
+		size_t i = 0; \
+		for(; i + VECTOR_WIDTH <= n; i += VECTOR_WIDTH) \
+		{ \
+			DoubleVector xs = *(const DoubleVector*)(a + i); \
+			DoubleVector ys = *(const DoubleVector*)(b + i); \
+			DoubleVector zs = *(const DoubleVector*)(c + i); \
+			DoubleVector result; \
+			for(size_t j = 0; j < VECTOR_WIDTH; j++) \
+			{ \
+				double x = xs[j]; \
+				double y = ys[j]; \
+				double z = zs[j]; \
+				result[j] = expression; \
+			} \
+			*(DoubleVector*)(out + i) = result; \
+		} \
+		for(; i < n; i++) \
+		{ \
+			double x = a[i]; \
+			double y = b[i]; \
+			double z = c[i]; \
+			out[i] = expression; \
+		} \
+	}
+
+DEFINE_FUSED_KERNEL(multiplyAddColumns, fma(x, y, z))
+DEFINE_FUSED_KERNEL(multiplySubtractColumns, fma(x, y, -z))
+DEFINE_FUSED_KERNEL(negatedMultiplyAddColumns, fma(-x, y, z))
+
+SIMD_DISPATCH void divideColumns(const double* a, const double* b, double* out, unsigned char* status, size_t n)
+{
+	const MaskVector nan = (MaskVector)(DoubleVector{} + numeric_limits<double>::quiet_NaN());
+	size_t i = 0;
+	for(; i + VECTOR_WIDTH <= n; i += VECTOR_WIDTH)
+	{
+		DoubleVector y = *(const DoubleVector*)(b + i);
+		MaskVector zero = y == 0;
+		MaskVector result = (MaskVector)(*(const DoubleVector*)(a + i) / y);
+		*(DoubleVector*)(out + i) = (DoubleVector)((result & ~zero) | (nan & zero));
+		*(StatusVector*)(status + i) |= __builtin_convertvector(zero, StatusVector) & (unsigned char)STATUS_DIVIDE_BY_ZERO;
+	}
+	for(; i < n; i++)
+	{
+		out[i] = divideNumbers(a[i], b[i], status[i]);
+	}
+}
+
+// Same multiplication order as integerPower(), so compiled columns and the
+// scalar path round identically; each pass is a plain vectorizable loop.
+SIMD_DISPATCH void integerPowerColumns(const double* a, double* out, int exponent, size_t n)
+{
+	double base[COLUMN_BLOCK_SIZE];
+	unsigned remaining = exponent < 0 ? -exponent : exponent;
+	for(size_t offset = 0; offset < n; offset += COLUMN_BLOCK_SIZE)
+	{
+		size_t count = n - offset < COLUMN_BLOCK_SIZE ? n - offset : COLUMN_BLOCK_SIZE;
+		const double* x = a + offset;
+		double* result = out + offset;
+		copy(x, x + count, base);
+		fill(result, result + count, 1.0);
+		for(unsigned bits = remaining; bits != 0;)
+		{
+			if(bits & 1)
+			{
+				for(size_t i = 0; i < count; i++) result[i] *= base[i];
+			}
+			bits >>= 1;
+			if(bits != 0)
+			{
+				for(size_t i = 0; i < count; i++) base[i] *= base[i];
+			}
+		}
+		if(exponent < 0)
+		{
+			for(size_t i = 0; i < count; i++) result[i] = 1 / result[i];
+		}
+	}
+}
+
+void powerColumns(const double* a, const double* b, double* out, unsigned char* status, size_t n)
+{
+	for(size_t i = 0; i < n; i++)
+	{
+		out[i] = powerNumbers(a[i], b[i], status[i]);
+	}
+}
+
+void rootColumns(const double* a, const double* b, double* out, unsigned char* status, size_t n)
+{
+	for(size_t i = 0; i < n; i++)
+	{
+		out[i] = rootNumbers(a[i], b[i], status[i]);
+	}
+}
+
+SIMD_DISPATCH bool anyFailed(const unsigned char* status, size_t n)
+{
+	unsigned char failed = STATUS_OK;
+	for(size_t i = 0; i < n; i++)
+	{
+		failed |= status[i];
+	}
+	return failed != STATUS_OK;
+}
+
+unsigned char firstFailure(const unsigned char* status, size_t n)
+{
+	for(size_t i = 0; i < n; i++)
+	{
+		if(status[i] != STATUS_OK) return status[i];
+	}
+	return STATUS_OK;
+}
+
+// Plugin ABI. A shared object exports CALCULATOR_PLUGIN_ENTRY as
+// extern "C" const CalculatorPlugin* calculatorPlugin(); the returned
+// tables must stay valid until the plugin is unloaded at exit. The scalar
+// kernel is required; the batch kernel may be null, in which case the
+// scalar kernel is applied row by row. Kernels OR CalculationStatus flags
+// into *status and must not throw.
+extern "C"
+{
+	typedef double (*CalculatorScalarKernel)(double n1, double n2, unsigned char* status);
+	typedef void (*CalculatorBatchKernel)(const double* a, const double* b, double* out, unsigned char* status, size_t n);
+
+	struct CalculatorPluginOperation
+	{
+		const char* name;
+		const char* symbol;
+		CalculatorScalarKernel scalar;
+		CalculatorBatchKernel batch;
+		unsigned char precedence;
+		unsigned char rightAssociative;
+	};
+
+	struct CalculatorPlugin
+	{
+		unsigned abiVersion;
+		size_t numberOfOperations;
+		const CalculatorPluginOperation* operations;
+	};
+
+	typedef const CalculatorPlugin* (*CalculatorPluginEntry)();
+}
+
+class Operation
+{
+protected:
+	string name;
+	string symbol;
+
+	void assertValidity()
+	{
+		if(name.empty()) throwException("Invalid operation name!");
+		if(symbol.empty()) throwException("Invalid operation symbol!");
+	}
+
+	void copyFrom(string name, string symbol)
+	{
+		this->name = name;
+		this->symbol = symbol;
+		assertValidity();
+	}
+
+public:
+	Operation(string name, string symbol)
+	{
+		copyFrom(name, symbol);
+	}
+
+	Operation(const Operation &other)
+	{
+		copyFrom(other.name, other.symbol);
+	}
+
+	Operation& operator=(const Operation &other)
+	{
+		if(this != &other)
+		{
+			copyFrom(other.name, other.symbol);
+		}
+		return *this;
+	}
+
+	virtual ~Operation() {};
+
+	virtual Operation* createNew() const = 0;
+
+	virtual Operation* cloneInto(void* memory) const = 0;
+
+	virtual double execute(const double n1, const double n2) = 0;
+
+	virtual double execute(const double n1, const double n2, unsigned char&)
+	{
+		return execute(n1, n2);
+	}
+
+	virtual void executeBatch(const double* a, const double* b, double* out, unsigned char* status, size_t n)
+	{
+		for(size_t i = 0; i < n; i++)
+		{
+			out[i] = execute(a[i], b[i], status[i]);
+		}
+	}
+
+	void executeBatch(const double* a, const double* b, double* out, size_t n)
+	{
+		unsigned char status[COLUMN_BLOCK_SIZE];
+		for(size_t offset = 0; offset < n; offset += COLUMN_BLOCK_SIZE)
+		{
+			size_t count = n - offset < COLUMN_BLOCK_SIZE ? n - offset : COLUMN_BLOCK_SIZE;
+			fill(status, status + count, STATUS_OK);
+			executeBatch(a + offset, b + offset, out + offset, status, count);
+			assertSuccess(firstFailure(status, count));
+		}
+	}
+
+	virtual Opcode getOpcode() const
+	{
+		return OPCODE_CALL;
+	}
+
+	virtual unsigned char getPrecedence() const
+	{
+		return 1;
+	}
+
+	virtual bool isRightAssociative() const
+	{
+		return false;
+	}
+
+	virtual CalculatorScalarKernel getScalarKernel() const
+	{
+		return nullptr;
+	}
+
+	const string& getName() const
+	{
+		return name;
+	}
+
+	const string& getSymbol() const
+	{
+		return symbol;
+	}
+
+	void setName(const string name)
+	{
+		this->name = name;
+		assertValidity();
+	}
+
+	void setSymbol(const string symbol)
+	{
+		this->symbol = symbol;
+		assertValidity();
+	}
+};
+
+template<typename T, typename... Arguments>
+T* placeOperation(void* memory, const Arguments&... arguments)
+{
+	static_assert(sizeof(T) <= OPERATION_SLOT_SIZE, "Operation does not fit in an arena slot!");
+	static_assert(alignof(T) <= alignof(max_align_t), "Operation is over-aligned for an arena slot!");
+	return new(memory) T(arguments...);
+}
+
+class AddOperation: public Operation
+{
+public:
+	AddOperation(): Operation("Add", "+") {};
+
+	AddOperation(const AddOperation &other): Operation(other) {};
+
+	AddOperation& operator=(const AddOperation &other)
+	{
+		Operation::operator=(other);
+		return *this;
+	}
+
+	AddOperation* createNew() const override
+	{
+		return new AddOperation(*this);
+	}
+
+	AddOperation* cloneInto(void* memory) const override
+	{
+		return placeOperation<AddOperation>(memory, *this);
+	}
+
+	static constexpr double apply(const double n1, const double n2)
+	{
+		return addNumbers(n1, n2);
+	}
+
+	double execute(const double n1, const double n2) override
+	{
+		return apply(n1, n2);
+	}
+
+	double execute(const double n1, const double n2, unsigned char&) override
+	{
+		return apply(n1, n2);
+	}
+
+	using Operation::executeBatch;
+
+	void executeBatch(const double* a, const double* b, double* out, unsigned char* status, size_t n) override
+	{
+		addColumns(a, b, out, status, n);
+	}
+
+	Opcode getOpcode() const override
+	{
+		return OPCODE_ADD;
+	}
+};
+
+class SubtractOperation: public Operation
+{
+public:
+	SubtractOperation(): Operation("Subtract", "-") {};
+
+	SubtractOperation(const SubtractOperation &other): Operation(other) {};
+
+	SubtractOperation& operator=(const SubtractOperation &other)
+	{
+		Operation::operator=(other);
+		return *this;
+	}
+
+	SubtractOperation* createNew() const override
+	{
+		return new SubtractOperation(*this);
+	}
+
+	SubtractOperation* cloneInto(void* memory) const override
+	{
+		return placeOperation<SubtractOperation>(memory, *this);
+	}
+
+	static constexpr double apply(const double n1, const double n2)
+	{
+		return subtractNumbers(n1, n2);
+	}
+	
+	double execute(const double n1, const double n2) override
+	{
+		return apply(n1, n2);
+	}
+
+	double execute(const double n1, const double n2, unsigned char&) override
+	{
+		return apply(n1, n2);
+	}
+
+	using Operation::executeBatch;
+
+	void executeBatch(const double* a, const double* b, double* out, unsigned char* status, size_t n) override
+	{
+		subtractColumns(a, b, out, status, n);
+	}
+
+	Opcode getOpcode() const override
+	{
+		return OPCODE_SUBTRACT;
+	}
+};
+
+class MultiplyOperation: public Operation
+{
+public:
+	MultiplyOperation(): Operation("Multiply", "*") {};
+
+	MultiplyOperation(const MultiplyOperation &other): Operation(other) {};
+
+	MultiplyOperation& operator=(const MultiplyOperation &other)
+	{
+		Operation::operator=(other);
+		return *this;
+	}
+
+	MultiplyOperation* createNew() const override
+	{
+		return new MultiplyOperation(*this);
+	}
+
+	MultiplyOperation* cloneInto(void* memory) const override
+	{
+		return placeOperation<MultiplyOperation>(memory, *this);
+	}
+
+	static constexpr double apply(const double n1, const double n2)
+	{
+		return multiplyNumbers(n1, n2);
+	}
+
+	double execute(const double n1, const double n2) override
+	{
+		return apply(n1, n2);
+	}
+
+	double execute(const double n1, const double n2, unsigned char&) override
+	{
+		return apply(n1, n2);
+	}
+
+	using Operation::executeBatch;
+
+	void executeBatch(const double* a, const double* b, double* out, unsigned char* status, size_t n) override
+	{
+		multiplyColumns(a, b, out, status, n);
+	}
+
+	Opcode getOpcode() const override
+	{
+		return OPCODE_MULTIPLY;
+	}
+
+	unsigned char getPrecedence() const override
+	{
+		return 2;
+	}
+};
+
+class DivideOperation: public Operation
+{
+public:
+	DivideOperation(): Operation("Divide", "/") {};
+
+	DivideOperation(const DivideOperation &other): Operation(other) {};
+
+	DivideOperation& operator=(const DivideOperation &other)
+	{
+		Operation::operator=(other);
+		return *this;
+	}
+
+	DivideOperation* createNew() const override
+	{
+		return new DivideOperation(*this);
+	}
+
+	DivideOperation* cloneInto(void* memory) const override
+	{
+		return placeOperation<DivideOperation>(memory, *this);
+	}
+
+	static constexpr double apply(const double n1, const double n2)
+	{
+		return divideNumbers(n1, n2);
+	}
+
+	double execute(const double n1, const double n2) override
+	{
+		return apply(n1, n2);
+	}
+
+	double execute(const double n1, const double n2, unsigned char& status) override
+	{
+		return divideNumbers(n1, n2, status);
+	}
+
+	using Operation::executeBatch;
+
+	void executeBatch(const double* a, const double* b, double* out, unsigned char* status, size_t n) override
+	{
+		divideColumns(a, b, out, status, n);
+	}
+
+	Opcode getOpcode() const override
+	{
+		return OPCODE_DIVIDE;
+	}
+
+	unsigned char getPrecedence() const override
+	{
+		return 2;
+	}
+};
+
+class PowerOperation: public Operation
+{
+public:
+	PowerOperation(): Operation("Power", "**") {};
+
+	PowerOperation(const PowerOperation &other): Operation(other) {};
+
+	PowerOperation& operator=(const PowerOperation &other)
+	{
+		Operation::operator=(other);
+		return *this;
+	}
+
+	PowerOperation* createNew() const override
+	{
+		return new PowerOperation(*this);
+	}
+
+	PowerOperation* cloneInto(void* memory) const override
+	{
+		return placeOperation<PowerOperation>(memory, *this);
+	}
+
+	static double apply(const double n1, const double n2)
+	{
+		return powerNumbers(n1, n2);
+	}
+
+	double execute(const double n1, const double n2) override
+	{
+		return apply(n1, n2);
+	}
+
+	double execute(const double n1, const double n2, unsigned char& status) override
+	{
+		return powerNumbers(n1, n2, status);
+	}
+
+	using Operation::executeBatch;
+
+	void executeBatch(const double* a, const double* b, double* out, unsigned char* status, size_t n) override
+	{
+		powerColumns(a, b, out, status, n);
+	}
+
+	Opcode getOpcode() const override
+	{
+		return OPCODE_POWER;
+	}
+
+	unsigned char getPrecedence() const override
+	{
+		return 3;
+	}
+
+	bool isRightAssociative() const override
+	{
+		return true;
+	}
+};
+
+class RootOperation: public Operation
+{
+public:
+	RootOperation(): Operation("Root", "V") {};
+
+	RootOperation(const RootOperation &other): Operation(other) {};
+
+	RootOperation& operator=(const RootOperation &other)
+	{
+		Operation::operator=(other);
+		return *this;
+	}
+
+	RootOperation* createNew() const override
+	{
+		return new RootOperation(*this);
+	}
+
+	RootOperation* cloneInto(void* memory) const override
+	{
+		return placeOperation<RootOperation>(memory, *this);
+	}
+
+	static double apply(const double n1, const double n2)
+	{
+		return rootNumbers(n1, n2);
+	}
+
+	double execute(const double n1, const double n2) override
+	{
+		return apply(n1, n2);
+	}
+
+	double execute(const double n1, const double n2, unsigned char& status) override
+	{
+		return rootNumbers(n1, n2, status);
+	}
+
+	using Operation::executeBatch;
+
+	void executeBatch(const double* a, const double* b, double* out, unsigned char* status, size_t n) override
+	{
+		rootColumns(a, b, out, status, n);
+	}
+
+	Opcode getOpcode() const override
+	{
+		return OPCODE_ROOT;
+	}
+
+	unsigned char getPrecedence() const override
+	{
+		return 3;
+	}
+
+	bool isRightAssociative() const override
+	{
+		return true;
+	}
+};
+
+class PluginOperation: public Operation
+{
+protected:
+	CalculatorScalarKernel scalar;
+	CalculatorBatchKernel batch;
+	unsigned char precedence;
+	bool rightAssociative;
+
+public:
+	PluginOperation(const CalculatorPluginOperation& operation): Operation(operation.name != nullptr ? operation.name : "", operation.symbol != nullptr ? operation.symbol : ""), scalar(operation.scalar), batch(operation.batch), precedence(operation.precedence), rightAssociative(operation.rightAssociative != 0)
+	{
+		if(scalar == nullptr) throwException("Plugin operation has no scalar kernel!");
+		if(precedence == 0) precedence = 1;
+	}
+
+	PluginOperation(const PluginOperation &other) = default;
+
+	PluginOperation& operator=(const PluginOperation &other) = default;
+
+	PluginOperation* createNew() const override
+	{
+		return new PluginOperation(*this);
+	}
+
+	PluginOperation* cloneInto(void* memory) const override
+	{
+		return placeOperation<PluginOperation>(memory, *this);
+	}
+
+	double execute(const double n1, const double n2) override
+	{
+		unsigned char status = STATUS_OK;
+		double result = scalar(n1, n2, &status);
+		assertSuccess(status);
+		return result;
+	}
+
+	double execute(const double n1, const double n2, unsigned char& status) override
+	{
+		return scalar(n1, n2, &status);
+	}
+
+	using Operation::executeBatch;
+
+	void executeBatch(const double* a, const double* b, double* out, unsigned char* status, size_t n) override
+	{
+		if(batch != nullptr)
+		{
+			batch(a, b, out, status, n);
+			return;
+		}
+		for(size_t i = 0; i < n; i++)
+		{
+			out[i] = scalar(a[i], b[i], &status[i]);
+		}
+	}
+
+	unsigned char getPrecedence() const override
+	{
+		return precedence;
+	}
+
+	bool isRightAssociative() const override
+	{
+		return rightAssociative;
+	}
+
+	CalculatorScalarKernel getScalarKernel() const override
+	{
+		return scalar;
+	}
+};
+
+// Symbol-to-prototype table behind createOperation(). Built-ins are
+// registered up front; plugins add to it at start-up, before any Calculator
+// is used from several threads.
+class OperationRegistry
+{
+protected:
+	vector<Operation*> prototypes;
+	vector<void*> libraries;
+
+	OperationRegistry()
+	{
+		registerOperation(AddOperation());
+		registerOperation(SubtractOperation());
+		registerOperation(MultiplyOperation());
+		registerOperation(DivideOperation());
+		registerOperation(PowerOperation());
+		registerOperation(RootOperation());
+	}
+
+public:
+	OperationRegistry(const OperationRegistry&) = delete;
+	OperationRegistry& operator=(const OperationRegistry&) = delete;
+
+	~OperationRegistry()
+	{
+		for(Operation* prototype : prototypes)
+		{
+			delete prototype;
+		}
+		for(void* library : libraries)
+		{
+			dlclose(library);
+		}
+	}
+
+	static OperationRegistry& global()
+	{
+		static OperationRegistry registry;
+		return registry;
+	}
+
+	void registerOperation(const Operation& prototype)
+	{
+		if(find(prototype.getSymbol()) != nullptr) throwException("Operation symbol is already registered!");
+		prototypes.push_back(prototype.createNew());
+	}
+
+	void loadPlugin(const char* path)
+	{
+		void* library = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+		if(library == nullptr)
+		{
+			cerr << dlerror() << endl;
+			throwException("Cannot load plugin!");
+		}
+		CalculatorPluginEntry entry = (CalculatorPluginEntry)dlsym(library, CALCULATOR_PLUGIN_ENTRY);
+		const CalculatorPlugin* plugin = entry != nullptr ? entry() : nullptr;
+		if(plugin == nullptr) throwException("Plugin has no " CALCULATOR_PLUGIN_ENTRY " entry point!");
+		if(plugin->abiVersion != CALCULATOR_PLUGIN_ABI_VERSION) throwException("Plugin was built for a different ABI version!");
+		libraries.push_back(library);
+		for(size_t i = 0; i < plugin->numberOfOperations; i++)
+		{
+			registerOperation(PluginOperation(plugin->operations[i]));
+		}
+	}
+
+	const Operation* find(const string& symbol) const
+	{
+		for(const Operation* prototype : prototypes)
+		{
+			if(prototype->getSymbol() == symbol) return prototype;
+		}
+		return nullptr;
+	}
+
+	size_t size() const
+	{
+		return prototypes.size();
+	}
+
+	const Operation& operator[](size_t index) const
+	{
+		return *prototypes[index];
+	}
+};
+
+const double exactPowersOfTen[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+inline bool parseNumber(const char* begin, const char* end, double& value, const char*& next)
+{
+	if(begin < end && *begin == '+' && begin + 1 < end && begin[1] != '-') begin++;
+	const char* text = begin;
+	bool negative = text < end && *text == '-';
+	text += negative;
+	unsigned long long mantissa = 0;
+	int digits = 0;
+	int fractionDigits = 0;
+	while(text < end && (unsigned)(*text - '0') < 10 && digits < 16)
+	{
+		mantissa = mantissa * 10 + (*text++ - '0');
+		digits++;
+	}
+	if(text < end && *text == '.')
+	{
+		text++;
+		while(text < end && (unsigned)(*text - '0') < 10 && digits < 16)
+		{
+			mantissa = mantissa * 10 + (*text++ - '0');
+			digits++;
+			fractionDigits++;
+		}
+	}
+	bool simple = digits > 0 && digits < 16;
+	if(simple && (text == end || !(isalnum((unsigned char)*text) || *text == '.' || *text == '_')))
+	{
+		double magnitude = (double)mantissa / exactPowersOfTen[fractionDigits];
+		value = negative ? -magnitude : magnitude;
+		next = text;
+		return true;
+	}
+	from_chars_result parsed = from_chars(begin, end, value);
+	if(parsed.ec != errc()) return false;
+	next = parsed.ptr;
+	return true;
+}
+
+inline void appendNumber(string& output, double value)
+{
+	char formatted[32];
+	to_chars_result written = to_chars(formatted, formatted + sizeof(formatted), value);
+	output.append(formatted, written.ptr - formatted);
+}
+
+inline unsigned long long bitsOf(double value)
+{
+	unsigned long long bits = 0;
+	const unsigned char* bytes = (const unsigned char*)&value;
+	for(size_t i = 0; i < sizeof(value); i++)
+	{
+		bits |= (unsigned long long)bytes[i] << (8 * i);
+	}
+	return bits;
+}
+
+inline bool isBlank(char character)
+{
+	return character == ' ' || character == '\t' || character == '\r';
+}
+
+inline bool isDelimiter(char character)
+{
+	return isBlank(character) || character == '(' || character == ')';
+}
+
+inline bool scanDecimal(const char* begin, const char* end, bool& negative, string& digits, long long& exponent)
+{
+	negative = false;
+	if(begin < end && (*begin == '+' || *begin == '-'))
+	{
+		negative = *begin == '-';
+		begin++;
+	}
+	digits.clear();
+	exponent = 0;
+	bool seenDigit = false;
+	bool fraction = false;
+	for(; begin < end; begin++)
+	{
+		if(*begin == '.' && !fraction)
+		{
+			fraction = true;
+			continue;
+		}
+		if((unsigned)(*begin - '0') >= 10) break;
+		seenDigit = true;
+		if(!digits.empty() || *begin != '0') digits.push_back(*begin);
+		exponent -= fraction;
+	}
+	if(!seenDigit) return false;
+	if(begin < end && (*begin == 'e' || *begin == 'E'))
+	{
+		begin++;
+		bool negativeExponent = begin < end && *begin == '-';
+		if(begin < end && (*begin == '+' || *begin == '-')) begin++;
+		if(begin == end || (unsigned)(*begin - '0') >= 10) return false;
+		long long value = 0;
+		for(; begin < end && (unsigned)(*begin - '0') < 10; begin++)
+		{
+			if(value < DECIMAL_EXPONENT_LIMIT) value = value * 10 + (*begin - '0');
+		}
+		exponent += negativeExponent ? -value : value;
+	}
+	return begin == end;
+}
+
+inline bool roundDigits(const string& digits, long long kept, unsigned __int128 limit, unsigned __int128& value)
+{
+	value = 0;
+	long long length = digits.size();
+	for(long long i = 0; i < kept; i++)
+	{
+		unsigned digit = i < length ? digits[i] - '0' : 0;
+		if(value > (limit - digit) / 10) return false;
+		value = value * 10 + digit;
+	}
+	if(kept < 0 || kept >= length) return true;
+	unsigned first = digits[kept] - '0';
+	bool sticky = digits.find_first_not_of('0', kept + 1) != string::npos;
+	if(first > 5 || (first == 5 && (sticky || (value & 1))))
+	{
+		if(value == limit) return false;
+		value++;
+	}
+	return true;
+}
+
+inline void appendDecimal(string& output, bool negative, const char* digits, size_t length, long long exponent)
+{
+	while(length > 0 && digits[length - 1] == '0')
+	{
+		length--;
+		exponent++;
+	}
+	if(length == 0)
+	{
+		output.push_back('0');
+		return;
+	}
+	if(negative) output.push_back('-');
+	long long point = (long long)length + exponent;
+	if(exponent >= 0 && point <= DECIMAL_PLAIN_DIGITS)
+	{
+		output.append(digits, length);
+		output.append(exponent, '0');
+	}
+	else if(exponent < 0 && point > -DECIMAL_PLAIN_ZEROS)
+	{
+		if(point <= 0)
+		{
+			output.append("0.");
+			output.append(-point, '0');
+			output.append(digits, length);
+		}
+		else
+		{
+			output.append(digits, point);
+			output.push_back('.');
+			output.append(digits + point, length - point);
+		}
+	}
+	else
+	{
+		output.push_back(digits[0]);
+		if(length > 1)
+		{
+			output.push_back('.');
+			output.append(digits + 1, length - 1);
+		}
+		output.append(point > 0 ? "e+" : "e");
+		output.append(to_string(point - 1));
+	}
+}
+
+inline void appendDigits(string& output, unsigned __int128 value)
+{
+	char digits[40];
+	char* end = digits + sizeof(digits);
+	char* begin = end;
+	do
+	{
+		*--begin = '0' + (char)(value % 10);
+		value /= 10;
+	} while(value != 0);
+	output.append(begin, end);
+}
+
+template<unsigned Decimals>
+class FixedPoint
+{
+protected:
+	long long raw;
+
+	static constexpr long long scale()
+	{
+		long long scale = 1;
+		for(unsigned i = 0; i < Decimals; i++) scale *= 10;
+		return scale;
+	}
+
+	static __int128 divideRounded(__int128 numerator, __int128 denominator)
+	{
+		__int128 quotient = numerator / denominator;
+		__int128 remainder = numerator % denominator;
+		if(remainder == 0) return quotient;
+		unsigned __int128 twice = (unsigned __int128)(remainder < 0 ? -remainder : remainder) * 2;
+		unsigned __int128 magnitude = denominator < 0 ? -denominator : denominator;
+		if(twice > magnitude || (twice == magnitude && (quotient & 1))) quotient += (numerator < 0) != (denominator < 0) ? -1 : 1;
+		return quotient;
+	}
+
+	static FixedPoint fromWide(__int128 value, unsigned char& status)
+	{
+		if(value > numeric_limits<long long>::max() || value < numeric_limits<long long>::min())
+		{
+			status |= STATUS_OVERFLOW;
+			return FixedPoint();
+		}
+		return fromRaw((long long)value);
+	}
+
+public:
+	FixedPoint(): raw(0) {};
+
+	static FixedPoint fromRaw(long long raw)
+	{
+		FixedPoint value;
+		value.raw = raw;
+		return value;
+	}
+
+	static FixedPoint one()
+	{
+		return fromRaw(scale());
+	}
+
+	long long getRaw() const
+	{
+		return raw;
+	}
+
+	bool isZero() const
+	{
+		return raw == 0;
+	}
+
+	bool toInteger(long long& integer) const
+	{
+		if(raw % scale() != 0) return false;
+		integer = raw / scale();
+		return true;
+	}
+
+	static bool parse(const char* begin, const char* end, FixedPoint& value, unsigned char& status)
+	{
+		thread_local string digits;
+		bool negative;
+		long long exponent;
+		if(!scanDecimal(begin, end, negative, digits, exponent)) return false;
+		if(digits.empty())
+		{
+			value = FixedPoint();
+			return true;
+		}
+		long long kept = (long long)digits.size() + exponent + Decimals;
+		unsigned __int128 magnitude;
+		if(kept > numeric_limits<long long>::digits10 + 1 || !roundDigits(digits, max(kept, -1LL), (unsigned __int128)numeric_limits<long long>::max() + negative, magnitude))
+		{
+			status |= STATUS_OVERFLOW;
+			return true;
+		}
+		value = fromRaw(negative ? (long long)-magnitude : (long long)magnitude);
+		return true;
+	}
+
+	void appendTo(string& output) const
+	{
+		unsigned __int128 magnitude = raw < 0 ? -(unsigned __int128)raw : (unsigned __int128)raw;
+		if(raw < 0) output.push_back('-');
+		appendDigits(output, magnitude / scale());
+		unsigned long long fraction = magnitude % scale();
+		if(fraction == 0) return;
+		char digits[Decimals + 1];
+		for(unsigned i = Decimals; i > 0; i--)
+		{
+			digits[i - 1] = '0' + fraction % 10;
+			fraction /= 10;
+		}
+		size_t length = Decimals;
+		while(digits[length - 1] == '0') length--;
+		output.push_back('.');
+		output.append(digits, length);
+	}
+
+	static FixedPoint add(const FixedPoint& n1, const FixedPoint& n2, unsigned char& status)
+	{
+		long long sum;
+		if(__builtin_add_overflow(n1.raw, n2.raw, &sum)) status |= STATUS_OVERFLOW;
+		return fromRaw(sum);
+	}
+
+	static FixedPoint subtract(const FixedPoint& n1, const FixedPoint& n2, unsigned char& status)
+	{
+		long long difference;
+		if(__builtin_sub_overflow(n1.raw, n2.raw, &difference)) status |= STATUS_OVERFLOW;
+		return fromRaw(difference);
+	}
+
+	static FixedPoint multiply(const FixedPoint& n1, const FixedPoint& n2, unsigned char& status)
+	{
+		return fromWide(divideRounded((__int128)n1.raw * n2.raw, scale()), status);
+	}
+
+	static FixedPoint divide(const FixedPoint& n1, const FixedPoint& n2, unsigned char& status)
+	{
+		if(n2.raw == 0)
+		{
+			status |= STATUS_DIVIDE_BY_ZERO;
+			return FixedPoint();
+		}
+		return fromWide(divideRounded((__int128)n1.raw * scale(), n2.raw), status);
+	}
+
+	bool operator==(const FixedPoint& other) const
+	{
+		return raw == other.raw;
+	}
+
+	bool operator<(const FixedPoint& other) const
+	{
+		return raw < other.raw;
+	}
+};
+
+class BigNatural
+{
+protected:
+	uint32_t inlineLimbs[BIG_INLINE_LIMBS];
+	uint32_t* limbs;
+	size_t size;
+	size_t capacity;
+
+	void reserve(size_t required)
+	{
+		if(required <= capacity) return;
+		size_t grown = max(required, capacity * 2);
+		uint32_t* grownLimbs = new uint32_t[grown];
+		copy(limbs, limbs + size, grownLimbs);
+		if(limbs != inlineLimbs) delete[] limbs;
+		limbs = grownLimbs;
+		capacity = grown;
+	}
+
+	void trim()
+	{
+		while(size > 0 && limbs[size - 1] == 0) size--;
+	}
+
+public:
+	BigNatural(): limbs(inlineLimbs), size(0), capacity(BIG_INLINE_LIMBS) {};
+
+	BigNatural(unsigned __int128 value): BigNatural()
+	{
+		while(value != 0)
+		{
+			reserve(size + 1);
+			limbs[size++] = (uint32_t)(value % BIG_LIMB_BASE);
+			value /= BIG_LIMB_BASE;
+		}
+	}
+
+	BigNatural(const BigNatural& other): BigNatural()
+	{
+		*this = other;
+	}
+
+	BigNatural(BigNatural&& other): BigNatural()
+	{
+		*this = move(other);
+	}
+
+	const BigNatural& operator=(const BigNatural& other)
+	{
+		if(this != &other)
+		{
+			reserve(other.size);
+			copy(other.limbs, other.limbs + other.size, limbs);
+			size = other.size;
+		}
+		return *this;
+	}
+
+	const BigNatural& operator=(BigNatural&& other)
+	{
+		if(this == &other) return *this;
+		if(other.limbs == other.inlineLimbs) return *this = other;
+		if(limbs != inlineLimbs) delete[] limbs;
+		limbs = other.limbs;
+		size = other.size;
+		capacity = other.capacity;
+		other.limbs = other.inlineLimbs;
+		other.size = 0;
+		other.capacity = BIG_INLINE_LIMBS;
+		return *this;
+	}
+
+	~BigNatural()
+	{
+		if(limbs != inlineLimbs) delete[] limbs;
+	}
+
+	static BigNatural fromDigits(const char* digits, size_t length)
+	{
+		BigNatural value;
+		value.reserve(length / BIG_LIMB_DIGITS + 1);
+		for(size_t end = length; end > 0;)
+		{
+			size_t begin = end > BIG_LIMB_DIGITS ? end - BIG_LIMB_DIGITS : 0;
+			uint32_t limb = 0;
+			for(size_t i = begin; i < end; i++) limb = limb * 10 + (digits[i] - '0');
+			value.limbs[value.size++] = limb;
+			end = begin;
+		}
+		value.trim();
+		return value;
+	}
+
+	bool isZero() const
+	{
+		return size == 0;
+	}
+
+	bool isOdd() const
+	{
+		return size != 0 && (limbs[0] & 1);
+	}
+
+	size_t countDigits() const
+	{
+		if(size == 0) return 0;
+		size_t digits = (size - 1) * BIG_LIMB_DIGITS;
+		for(uint32_t top = limbs[size - 1]; top != 0; top /= 10) digits++;
+		return digits;
+	}
+
+	unsigned __int128 toUnsigned() const
+	{
+		unsigned __int128 value = 0;
+		for(size_t i = size; i > 0; i--) value = value * BIG_LIMB_BASE + limbs[i - 1];
+		return value;
+	}
+
+	void appendDigits(string& output) const
+	{
+		if(size == 0) return;
+		output.append(to_string(limbs[size - 1]));
+		for(size_t i = size - 1; i > 0; i--)
+		{
+			char digits[BIG_LIMB_DIGITS];
+			uint32_t limb = limbs[i - 1];
+			for(size_t j = BIG_LIMB_DIGITS; j > 0; j--)
+			{
+				digits[j - 1] = '0' + limb % 10;
+				limb /= 10;
+			}
+			output.append(digits, BIG_LIMB_DIGITS);
+		}
+	}
+
+	static int compare(const BigNatural& n1, const BigNatural& n2)
+	{
+		if(n1.size != n2.size) return n1.size < n2.size ? -1 : 1;
+		for(size_t i = n1.size; i > 0; i--)
+		{
+			if(n1.limbs[i - 1] != n2.limbs[i - 1]) return n1.limbs[i - 1] < n2.limbs[i - 1] ? -1 : 1;
+		}
+		return 0;
+	}
+
+	void add(const BigNatural& other)
+	{
+		reserve(max(size, other.size) + 1);
+		uint32_t carry = 0;
+		for(size_t i = 0; i < max(size, other.size) || carry != 0; i++)
+		{
+			if(i == size) limbs[size++] = 0;
+			uint32_t sum = limbs[i] + (i < other.size ? other.limbs[i] : 0) + carry;
+			carry = sum >= BIG_LIMB_BASE;
+			limbs[i] = sum - carry * BIG_LIMB_BASE;
+		}
+	}
+
+	void subtract(const BigNatural& other)
+	{
+		uint32_t borrow = 0;
+		for(size_t i = 0; i < size && (i < other.size || borrow != 0); i++)
+		{
+			uint32_t subtrahend = (i < other.size ? other.limbs[i] : 0) + borrow;
+			borrow = limbs[i] < subtrahend;
+			limbs[i] = limbs[i] + borrow * BIG_LIMB_BASE - subtrahend;
+		}
+		trim();
+	}
+
+	static BigNatural multiply(const BigNatural& n1, const BigNatural& n2)
+	{
+		BigNatural product;
+		if(n1.isZero() || n2.isZero()) return product;
+		product.reserve(n1.size + n2.size);
+		fill(product.limbs, product.limbs + n1.size + n2.size, 0);
+		for(size_t i = 0; i < n1.size; i++)
+		{
+			uint64_t carry = 0;
+			for(size_t j = 0; j < n2.size; j++)
+			{
+				uint64_t current = product.limbs[i + j] + (uint64_t)n1.limbs[i] * n2.limbs[j] + carry;
+				product.limbs[i + j] = (uint32_t)(current % BIG_LIMB_BASE);
+				carry = current / BIG_LIMB_BASE;
+			}
+			product.limbs[i + n2.size] = (uint32_t)carry;
+		}
+		product.size = n1.size + n2.size;
+		product.trim();
+		return product;
+	}
+
+	void multiplySmall(uint32_t factor)
+	{
+		uint64_t carry = 0;
+		for(size_t i = 0; i < size; i++)
+		{
+			uint64_t current = (uint64_t)limbs[i] * factor + carry;
+			limbs[i] = (uint32_t)(current % BIG_LIMB_BASE);
+			carry = current / BIG_LIMB_BASE;
+		}
+		if(carry != 0)
+		{
+			reserve(size + 1);
+			limbs[size++] = (uint32_t)carry;
+		}
+		trim();
+	}
+
+	uint32_t divideSmall(uint32_t divisor)
+	{
+		uint64_t remainder = 0;
+		for(size_t i = size; i > 0; i--)
+		{
+			uint64_t current = remainder * BIG_LIMB_BASE + limbs[i - 1];
+			limbs[i - 1] = (uint32_t)(current / divisor);
+			remainder = current % divisor;
+		}
+		trim();
+		return (uint32_t)remainder;
+	}
+
+	void shiftDigits(size_t digits)
+	{
+		if(size == 0) return;
+		size_t shift = digits / BIG_LIMB_DIGITS;
+		reserve(size + shift + 1);
+		copy_backward(limbs, limbs + size, limbs + size + shift);
+		fill(limbs, limbs + shift, 0);
+		size += shift;
+		uint32_t factor = 1;
+		for(size_t i = 0; i < digits % BIG_LIMB_DIGITS; i++) factor *= 10;
+		multiplySmall(factor);
+	}
+
+	// Removes the lowest digits and rounds the rest half to even; sticky
+	// stands for non-zero digits already discarded below them.
+	void roundDigits(size_t digits, bool sticky = false)
+	{
+		if(digits == 0) return;
+		size_t shift = min((digits - 1) / BIG_LIMB_DIGITS, size);
+		sticky |= any_of(limbs, limbs + shift, [](uint32_t limb) { return limb != 0; });
+		copy(limbs + shift, limbs + size, limbs);
+		size -= shift;
+		uint32_t divisor = 1;
+		for(size_t i = 0; i < (digits - 1) % BIG_LIMB_DIGITS; i++) divisor *= 10;
+		sticky |= divideSmall(divisor) != 0;
+		uint32_t first = divideSmall(10);
+		if(first > 5 || (first == 5 && (sticky || isOdd()))) add(BigNatural(1));
+	}
+};
+
+class BigDecimal
+{
+protected:
+	BigNatural magnitude;
+	long long exponent;
+	bool negative;
+
+	friend class Decimal128;
+
+	static BigDecimal make(bool negative, BigNatural&& magnitude, long long exponent, unsigned char& status)
+	{
+		BigDecimal value;
+		if(magnitude.countDigits() > BIG_DECIMAL_MAX_DIGITS || exponent > DECIMAL_EXPONENT_LIMIT || exponent < -DECIMAL_EXPONENT_LIMIT)
+		{
+			status |= STATUS_OVERFLOW;
+			return value;
+		}
+		if(magnitude.isZero()) return value;
+		value.magnitude = move(magnitude);
+		value.exponent = exponent;
+		value.negative = negative;
+		return value;
+	}
+
+	static BigDecimal addSigned(const BigDecimal& n1, const BigDecimal& n2, bool negate, unsigned char& status)
+	{
+		bool negative2 = n2.negative != negate;
+		if(n1.isZero() || n2.isZero())
+		{
+			BigDecimal value = n1.isZero() ? n2 : n1;
+			value.negative = n1.isZero() ? negative2 && !n2.isZero() : n1.negative;
+			return value;
+		}
+		long long exponent = min(n1.exponent, n2.exponent);
+		if(max(n1.exponent, n2.exponent) - exponent > BIG_DECIMAL_MAX_DIGITS)
+		{
+			status |= STATUS_OVERFLOW;
+			return BigDecimal();
+		}
+		BigNatural magnitude1 = n1.magnitude;
+		BigNatural magnitude2 = n2.magnitude;
+		magnitude1.shiftDigits(n1.exponent - exponent);
+		magnitude2.shiftDigits(n2.exponent - exponent);
+		if(n1.negative == negative2)
+		{
+			magnitude1.add(magnitude2);
+			return make(n1.negative, move(magnitude1), exponent, status);
+		}
+		if(BigNatural::compare(magnitude1, magnitude2) < 0)
+		{
+			magnitude2.subtract(magnitude1);
+			return make(negative2, move(magnitude2), exponent, status);
+		}
+		magnitude1.subtract(magnitude2);
+		return make(n1.negative, move(magnitude1), exponent, status);
+	}
+
+public:
+	BigDecimal(): exponent(0), negative(false) {};
+
+	static BigDecimal one()
+	{
+		BigDecimal value;
+		value.magnitude = BigNatural(1);
+		return value;
+	}
+
+	bool isZero() const
+	{
+		return magnitude.isZero();
+	}
+
+	bool toInteger(long long& integer) const
+	{
+		if(isZero())
+		{
+			integer = 0;
+			return true;
+		}
+		BigNatural whole = magnitude;
+		if(exponent < 0)
+		{
+			for(long long i = 0; i < -exponent; i++)
+			{
+				if(whole.divideSmall(10) != 0) return false;
+			}
+		}
+		else if(exponent > BIG_INTEGER_DIGITS) return false;
+		else whole.shiftDigits(exponent);
+		if(whole.countDigits() > BIG_INTEGER_DIGITS) return false;
+		integer = (long long)whole.toUnsigned();
+		if(negative) integer = -integer;
+		return true;
+	}
+
+	static bool parse(const char* begin, const char* end, BigDecimal& value, unsigned char& status)
+	{
+		thread_local string digits;
+		bool negative;
+		long long exponent;
+		if(!scanDecimal(begin, end, negative, digits, exponent)) return false;
+		value = make(negative, BigNatural::fromDigits(digits.data(), digits.size()), exponent, status);
+		return true;
+	}
+
+	void appendTo(string& output) const
+	{
+		thread_local string digits;
+		digits.clear();
+		magnitude.appendDigits(digits);
+		appendDecimal(output, negative, digits.data(), digits.size(), exponent);
+	}
+
+	static BigDecimal add(const BigDecimal& n1, const BigDecimal& n2, unsigned char& status)
+	{
+		return addSigned(n1, n2, false, status);
+	}
+
+	static BigDecimal subtract(const BigDecimal& n1, const BigDecimal& n2, unsigned char& status)
+	{
+		return addSigned(n1, n2, true, status);
+	}
+
+	static BigDecimal multiply(const BigDecimal& n1, const BigDecimal& n2, unsigned char& status)
+	{
+		return make(n1.negative != n2.negative, BigNatural::multiply(n1.magnitude, n2.magnitude), n1.exponent + n2.exponent, status);
+	}
+
+	static BigDecimal divide(const BigDecimal& n1, const BigDecimal& n2, unsigned char& status, size_t significantDigits = BIG_DECIMAL_DIVISION_DIGITS)
+	{
+		if(n2.isZero())
+		{
+			status |= STATUS_DIVIDE_BY_ZERO;
+			return BigDecimal();
+		}
+		if(n1.isZero()) return BigDecimal();
+		long long shift = (long long)n1.magnitude.countDigits() - (long long)n2.magnitude.countDigits();
+		BigNatural remainder = n1.magnitude;
+		BigNatural divisor = n2.magnitude;
+		if(shift > 0) divisor.shiftDigits(shift);
+		else remainder.shiftDigits(-shift);
+		if(BigNatural::compare(remainder, divisor) < 0)
+		{
+			remainder.multiplySmall(10);
+			shift--;
+		}
+		BigNatural quotient;
+		for(size_t i = 0; i <= significantDigits; i++)
+		{
+			uint32_t digit = 0;
+			while(BigNatural::compare(remainder, divisor) >= 0)
+			{
+				remainder.subtract(divisor);
+				digit++;
+			}
+			quotient.multiplySmall(10);
+			quotient.add(BigNatural(digit));
+			remainder.multiplySmall(10);
+		}
+		quotient.roundDigits(1, !remainder.isZero());
+		long long exponent = n1.exponent - n2.exponent + shift - (long long)significantDigits + 1;
+		if(quotient.countDigits() > significantDigits)
+		{
+			quotient.divideSmall(10);
+			exponent++;
+		}
+		return make(n1.negative != n2.negative, move(quotient), exponent, status);
+	}
+
+	bool operator==(const BigDecimal& other) const
+	{
+		unsigned char status = STATUS_OK;
+		return subtract(*this, other, status).isZero() && status == STATUS_OK;
+	}
+
+	// Unlike subtracting, this cannot overflow: magnitudes are only aligned
+	// once their leading digits are known to line up.
+	bool operator<(const BigDecimal& other) const
+	{
+		bool negative1 = negative && !isZero();
+		bool negative2 = other.negative && !other.isZero();
+		if(negative1 != negative2) return negative1;
+		int order;
+		if(isZero() || other.isZero()) order = (int)!isZero() - (int)!other.isZero();
+		else
+		{
+			long long leading1 = exponent + (long long)magnitude.countDigits();
+			long long leading2 = other.exponent + (long long)other.magnitude.countDigits();
+			if(leading1 != leading2) order = leading1 < leading2 ? -1 : 1;
+			else
+			{
+				long long lowest = min(exponent, other.exponent);
+				BigNatural magnitude1 = magnitude;
+				BigNatural magnitude2 = other.magnitude;
+				magnitude1.shiftDigits(exponent - lowest);
+				magnitude2.shiftDigits(other.exponent - lowest);
+				order = BigNatural::compare(magnitude1, magnitude2);
+			}
+		}
+		return negative1 ? order > 0 : order < 0;
+	}
+};
+
+class Decimal128
+{
+protected:
+	unsigned __int128 coefficient;
+	int exponent;
+	bool negative;
+
+	static Decimal128 fromBig(BigDecimal&& value, unsigned char& status)
+	{
+		Decimal128 result;
+		if(value.isZero()) return result;
+		long long exponent = value.exponent;
+		size_t digits = value.magnitude.countDigits();
+		if(digits > DECIMAL128_DIGITS)
+		{
+			value.magnitude.roundDigits(digits - DECIMAL128_DIGITS);
+			exponent += digits - DECIMAL128_DIGITS;
+			if(value.magnitude.countDigits() > DECIMAL128_DIGITS)
+			{
+				value.magnitude.divideSmall(10);
+				exponent++;
+			}
+		}
+		if(exponent < DECIMAL128_MIN_EXPONENT)
+		{
+			if(DECIMAL128_MIN_EXPONENT - exponent > DECIMAL128_DIGITS + 1) return result;
+			value.magnitude.roundDigits(DECIMAL128_MIN_EXPONENT - exponent);
+			exponent = DECIMAL128_MIN_EXPONENT;
+			if(value.magnitude.isZero()) return result;
+		}
+		while(exponent > DECIMAL128_MAX_EXPONENT && value.magnitude.countDigits() < DECIMAL128_DIGITS)
+		{
+			value.magnitude.multiplySmall(10);
+			exponent--;
+		}
+		if(exponent > DECIMAL128_MAX_EXPONENT)
+		{
+			status |= STATUS_OVERFLOW;
+			return result;
+		}
+		result.coefficient = value.magnitude.toUnsigned();
+		result.exponent = (int)exponent;
+		result.negative = value.negative;
+		return result;
+	}
+
+	BigDecimal toBig() const
+	{
+		BigDecimal value;
+		if(coefficient == 0) return value;
+		value.magnitude = BigNatural(coefficient);
+		value.exponent = exponent;
+		value.negative = negative;
+		return value;
+	}
+
+	long long adjustedExponent() const
+	{
+		long long digits = 0;
+		for(unsigned __int128 rest = coefficient; rest != 0; rest /= 10) digits++;
+		return exponent + digits;
+	}
+
+public:
+	Decimal128(): coefficient(0), exponent(0), negative(false) {};
+
+	static Decimal128 one()
+	{
+		Decimal128 value;
+		value.coefficient = 1;
+		return value;
+	}
+
+	bool isZero() const
+	{
+		return coefficient == 0;
+	}
+
+	bool toInteger(long long& integer) const
+	{
+		return toBig().toInteger(integer);
+	}
+
+	static bool parse(const char* begin, const char* end, Decimal128& value, unsigned char& status)
+	{
+		thread_local string digits;
+		bool negative;
+		long long exponent;
+		if(!scanDecimal(begin, end, negative, digits, exponent)) return false;
+		long long kept = min((long long)digits.size(), (long long)DECIMAL128_DIGITS);
+		unsigned __int128 coefficient;
+		roundDigits(digits, kept, DECIMAL128_COEFFICIENT_LIMIT, coefficient);
+		BigDecimal exact;
+		exact.magnitude = BigNatural(coefficient);
+		exact.exponent = exponent + (long long)digits.size() - kept;
+		exact.negative = negative;
+		value = fromBig(move(exact), status);
+		return true;
+	}
+
+	void appendTo(string& output) const
+	{
+		string digits;
+		if(coefficient != 0) appendDigits(digits, coefficient);
+		appendDecimal(output, negative, digits.data(), digits.size(), exponent);
+	}
+
+	static Decimal128 add(const Decimal128& n1, const Decimal128& n2, unsigned char& status)
+	{
+		if(!n1.isZero() && !n2.isZero())
+		{
+			long long distance = n1.adjustedExponent() - n2.adjustedExponent();
+			if(distance > DECIMAL128_ALIGNMENT_DIGITS) return n1;
+			if(distance < -DECIMAL128_ALIGNMENT_DIGITS) return n2;
+		}
+		return fromBig(BigDecimal::add(n1.toBig(), n2.toBig(), status), status);
+	}
+
+	static Decimal128 subtract(const Decimal128& n1, const Decimal128& n2, unsigned char& status)
+	{
+		Decimal128 negated = n2;
+		negated.negative = !n2.negative;
+		return add(n1, negated, status);
+	}
+
+	static Decimal128 multiply(const Decimal128& n1, const Decimal128& n2, unsigned char& status)
+	{
+		return fromBig(BigDecimal::multiply(n1.toBig(), n2.toBig(), status), status);
+	}
+
+	static Decimal128 divide(const Decimal128& n1, const Decimal128& n2, unsigned char& status)
+	{
+		return fromBig(BigDecimal::divide(n1.toBig(), n2.toBig(), status, DECIMAL128_DIGITS), status);
+	}
+
+	bool operator==(const Decimal128& other) const
+	{
+		return toBig() == other.toBig();
+	}
+
+	bool operator<(const Decimal128& other) const
+	{
+		return toBig() < other.toBig();
+	}
+};
+
+// Integer exponents are computed by squaring in the backend itself; any
+// other exponent has no exact answer and is reported instead of rounded.
+template<typename Number>
+Number exactPower(const Number& base, const Number& exponent, unsigned char& status)
+{
+	long long integer;
+	if(!exponent.toInteger(integer))
+	{
+		status |= STATUS_NOT_EXACT;
+		return Number();
+	}
+	if(integer == 0 && base.isZero())
+	{
+		status |= STATUS_ZERO_TO_POWER_OF_ZERO;
+		return Number();
+	}
+	unsigned long long remaining = integer < 0 ? -(unsigned long long)integer : integer;
+	Number result = Number::one();
+	Number square = base;
+	while(remaining != 0 && !(status & STATUS_OVERFLOW))
+	{
+		if(remaining & 1) result = Number::multiply(result, square, status);
+		remaining >>= 1;
+		if(remaining != 0) square = Number::multiply(square, square, status);
+	}
+	if(integer < 0) result = Number::divide(Number::one(), result, status);
+	return result;
+}
+
+// Roots are estimated in double precision and accepted only when raising the
+// estimate back to the degree reproduces the radicand exactly.
+template<typename Number>
+Number exactRoot(const Number& base, const Number& degree, unsigned char& status)
+{
+	string text;
+	base.appendTo(text);
+	double radicand = strtod(text.c_str(), nullptr);
+	text.clear();
+	degree.appendTo(text);
+	unsigned char rootStatus = STATUS_OK;
+	double estimate = rootNumbers(radicand, strtod(text.c_str(), nullptr), rootStatus);
+	if(rootStatus != STATUS_OK)
+	{
+		status |= rootStatus;
+		return Number();
+	}
+	text.clear();
+	if(isfinite(estimate)) appendNumber(text, estimate);
+	Number root;
+	unsigned char checkStatus = STATUS_OK;
+	if(text.empty() || !Number::parse(text.data(), text.data() + text.size(), root, checkStatus) || checkStatus != STATUS_OK || !(exactPower(root, degree, checkStatus) == base) || checkStatus != STATUS_OK)
+	{
+		status |= STATUS_NOT_EXACT;
+		return Number();
+	}
+	return root;
+}
+
+template<typename Number>
+Number applyExact(unsigned char opcode, const Number& n1, const Number& n2, unsigned char& status)
+{
+	switch(opcode)
+	{
+		case OPCODE_ADD: return Number::add(n1, n2, status);
+		case OPCODE_SUBTRACT: return Number::subtract(n1, n2, status);
+		case OPCODE_MULTIPLY: return Number::multiply(n1, n2, status);
+		case OPCODE_DIVIDE: return Number::divide(n1, n2, status);
+		case OPCODE_POWER: return exactPower(n1, n2, status);
+		case OPCODE_ROOT: return exactRoot(n1, n2, status);
+	}
+	status |= STATUS_NOT_EXACT;
+	return Number();
+}
+
+enum NumberBackend: unsigned char
+{
+	NUMBERS_DOUBLE,
+	NUMBERS_FIXED_POINT,
+	NUMBERS_DECIMAL128,
+	NUMBERS_BIG_DECIMAL
+};
+
+struct FailureSummary
+{
+	unsigned long long failures;
+	unsigned long long counts[NUMBER_OF_STATUS_FLAGS];
+
+	FailureSummary(): failures(0), counts() {};
+
+	void record(unsigned char status)
+	{
+		failures++;
+		for(size_t i = 0; i < NUMBER_OF_STATUS_FLAGS; i++)
+		{
+			counts[i] += (status >> i) & 1;
+		}
+	}
+
+	void merge(const FailureSummary& other)
+	{
+		failures += other.failures;
+		for(size_t i = 0; i < NUMBER_OF_STATUS_FLAGS; i++)
+		{
+			counts[i] += other.counts[i];
+		}
+	}
+
+	void print(ostream& out) const
+	{
+		if(failures == 0) return;
+		out << failures << " calculation(s) failed:" << endl;
+		for(size_t i = 0; i < NUMBER_OF_STATUS_FLAGS; i++)
+		{
+			if(counts[i] != 0) out << "  " << describeStatus(1 << i) << " x" << counts[i] << endl;
+		}
+	}
+};
+
+// Counts magnitudes in log-linear buckets: the exponent and the top
+// QUANTILE_SKETCH_BITS mantissa bits of a double, so a bucket spans a
+// relative width of 2^-QUANTILE_SKETCH_BITS and quantiles come back within
+// half of that. Buckets are stored densely between the lowest and highest
+// one seen, which stays small unless results span many orders of magnitude.
+class QuantileSketch
+{
+protected:
+	struct Store
+	{
+		vector<unsigned long long> counts;
+		size_t first;
+
+		Store(): first(0) {};
+
+		void add(size_t bucket, unsigned long long n)
+		{
+			if(counts.empty()) first = bucket;
+			if(bucket < first)
+			{
+				counts.insert(counts.begin(), first - bucket, 0);
+				first = bucket;
+			}
+			else if(bucket - first >= counts.size()) counts.resize(bucket - first + 1, 0);
+			counts[bucket - first] += n;
+		}
+
+		void merge(const Store& other)
+		{
+			if(other.counts.empty()) return;
+			add(other.first, 0);
+			add(other.first + other.counts.size() - 1, 0);
+			for(size_t i = 0; i < other.counts.size(); i++)
+			{
+				counts[other.first + i - first] += other.counts[i];
+			}
+		}
+	};
+
+	Store positive;
+	Store negative;
+	unsigned long long count;
+
+	static size_t bucketOf(double magnitude)
+	{
+		return bitsOf(magnitude) >> (52 - QUANTILE_SKETCH_BITS);
+	}
+
+	static double bucketMiddle(size_t bucket)
+	{
+		unsigned long long lower = (unsigned long long)bucket << (52 - QUANTILE_SKETCH_BITS);
+		unsigned long long width = 1ULL << (52 - QUANTILE_SKETCH_BITS);
+		unsigned long long middle = lower + width / 2;
+		double value;
+		memcpy(&value, &middle, sizeof(value));
+		return value;
+	}
+
+public:
+	QuantileSketch(): count(0) {};
+
+	void record(double value)
+	{
+		if(value != value) return;
+		if(signbit(value)) negative.add(bucketOf(-value), 1);
+		else positive.add(bucketOf(value), 1);
+		count++;
+	}
+
+	void merge(const QuantileSketch& other)
+	{
+		positive.merge(other.positive);
+		negative.merge(other.negative);
+		count += other.count;
+	}
+
+	unsigned long long getCount() const
+	{
+		return count;
+	}
+
+	double quantile(double fraction) const
+	{
+		if(count == 0) return numeric_limits<double>::quiet_NaN();
+		unsigned long long rank = (unsigned long long)(fraction * (count - 1));
+		unsigned long long seen = 0;
+		for(size_t i = negative.counts.size(); i-- > 0;)
+		{
+			seen += negative.counts[i];
+			if(seen > rank) return -bucketMiddle(negative.first + i);
+		}
+		for(size_t i = 0; i < positive.counts.size(); i++)
+		{
+			seen += positive.counts[i];
+			if(seen > rank) return bucketMiddle(positive.first + i);
+		}
+		return numeric_limits<double>::quiet_NaN();
+	}
+};
+
+// Sum, mean, minimum and maximum kept in an exact backend's own number
+// type. Results arrive as the text the backend printed, which reads back
+// without loss; text the backend cannot read, or a sum it cannot hold,
+// turns the totals into that error.
+class ExactTotals
+{
+public:
+	virtual ~ExactTotals() {};
+	virtual ExactTotals* clone() const = 0;
+	virtual void record(const char* begin, const char* end) = 0;
+	virtual void merge(const ExactTotals& other) = 0;
+	virtual void appendSum(string& output) const = 0;
+	virtual void appendMean(string& output) const = 0;
+	virtual void appendMinimum(string& output) const = 0;
+	virtual void appendMaximum(string& output) const = 0;
+};
+
+template<typename Number>
+class NumberTotals: public ExactTotals
+{
+protected:
+	unsigned long long count;
+	Number sum;
+	Number minimum;
+	Number maximum;
+	unsigned char status;
+	unsigned char sumStatus;
+
+	void add(const Number& value, const Number& low, const Number& high)
+	{
+		sum = count == 0 ? value : Number::add(sum, value, sumStatus);
+		if(count == 0 || low < minimum) minimum = low;
+		if(count == 0 || maximum < high) maximum = high;
+	}
+
+	void append(string& output, const Number& value, unsigned char valueStatus) const
+	{
+		if(count == 0) appendNumber(output, numeric_limits<double>::quiet_NaN());
+		else if(valueStatus != STATUS_OK)
+		{
+			output += "error: ";
+			output += describeStatus(valueStatus);
+		}
+		else value.appendTo(output);
+	}
+
+public:
+	NumberTotals(): count(0), status(STATUS_OK), sumStatus(STATUS_OK) {};
+
+	ExactTotals* clone() const override
+	{
+		return new NumberTotals(*this);
+	}
+
+	void record(const char* begin, const char* end) override
+	{
+		Number value;
+		unsigned char parsed = STATUS_OK;
+		if(!Number::parse(begin, end, value, parsed)) parsed |= STATUS_NOT_EXACT;
+		status |= parsed;
+		add(value, value, value);
+		count++;
+	}
+
+	void merge(const ExactTotals& totals) override
+	{
+		const NumberTotals& other = static_cast<const NumberTotals&>(totals);
+		if(other.count == 0) return;
+		status |= other.status;
+		sumStatus |= other.sumStatus;
+		add(other.sum, other.minimum, other.maximum);
+		count += other.count;
+	}
+
+	void appendSum(string& output) const override
+	{
+		append(output, sum, status | sumStatus);
+	}
+
+	void appendMean(string& output) const override
+	{
+		unsigned char meanStatus = status | sumStatus;
+		string text = to_string(count);
+		Number divisor;
+		Number::parse(text.data(), text.data() + text.size(), divisor, meanStatus);
+		Number mean = Number::divide(sum, divisor, meanStatus);
+		append(output, mean, meanStatus);
+	}
+
+	void appendMinimum(string& output) const override
+	{
+		append(output, minimum, status);
+	}
+
+	void appendMaximum(string& output) const override
+	{
+		append(output, maximum, status);
+	}
+};
+
+// One-pass statistics over successful results. The sum is compensated as
+// in Neumaier's variant of Kahan summation, the mean and variance follow
+// Welford, and partials merge with the pairwise update of Chan et al.
+// Quantile estimates are clamped to the exact minimum and maximum. Under an
+// exact backend the sum, mean, minimum and maximum come from ExactTotals
+// instead, and the lines still computed in double say so.
+struct ResultAggregate
+{
+	unsigned long long count;
+	double sum;
+	double compensation;
+	double mean;
+	double squaredDeviations;
+	double minimum;
+	double maximum;
+	QuantileSketch quantiles;
+	NumberBackend numbers;
+	unique_ptr<ExactTotals> exact;
+
+	static ExactTotals* makeTotals(NumberBackend numbers)
+	{
+		switch(numbers)
+		{
+			case NUMBERS_FIXED_POINT: return new NumberTotals<FixedPoint<FIXED_POINT_DECIMALS>>();
+			case NUMBERS_DECIMAL128: return new NumberTotals<Decimal128>();
+			case NUMBERS_BIG_DECIMAL: return new NumberTotals<BigDecimal>();
+			case NUMBERS_DOUBLE: break;
+		}
+		return nullptr;
+	}
+
+	ResultAggregate(NumberBackend numbers = NUMBERS_DOUBLE): count(0), sum(0), compensation(0), mean(0), squaredDeviations(0), minimum(numeric_limits<double>::infinity()), maximum(-numeric_limits<double>::infinity()), numbers(numbers), exact(makeTotals(numbers)) {};
+
+	ResultAggregate(const ResultAggregate& other): count(other.count), sum(other.sum), compensation(other.compensation), mean(other.mean), squaredDeviations(other.squaredDeviations), minimum(other.minimum), maximum(other.maximum), quantiles(other.quantiles), numbers(other.numbers), exact(other.exact != nullptr ? other.exact->clone() : nullptr) {};
+
+	ResultAggregate& operator=(const ResultAggregate& other)
+	{
+		if(this == &other) return *this;
+		count = other.count;
+		sum = other.sum;
+		compensation = other.compensation;
+		mean = other.mean;
+		squaredDeviations = other.squaredDeviations;
+		minimum = other.minimum;
+		maximum = other.maximum;
+		quantiles = other.quantiles;
+		numbers = other.numbers;
+		exact.reset(other.exact != nullptr ? other.exact->clone() : nullptr);
+		return *this;
+	}
+
+	void add(double value)
+	{
+		double total = sum + value;
+		compensation += fabs(sum) >= fabs(value) ? (sum - total) + value : (value - total) + sum;
+		sum = total;
+	}
+
+	void record(double value)
+	{
+		count++;
+		add(value);
+		double delta = value - mean;
+		mean += delta / count;
+		squaredDeviations += delta * (value - mean);
+		minimum = fmin(minimum, value);
+		maximum = fmax(maximum, value);
+		quantiles.record(value);
+	}
+
+	// A result as printed: exact backends keep it in their own type, and
+	// its double value feeds the variance and quantiles.
+	void record(const char* begin, const char* end)
+	{
+		if(exact != nullptr) exact->record(begin, end);
+		double value;
+		const char* parsed;
+		record(parseNumber(begin, end, value, parsed) ? value : numeric_limits<double>::quiet_NaN());
+	}
+
+	void merge(const ResultAggregate& other)
+	{
+		if(other.count == 0) return;
+		if(other.numbers != numbers) throwException("Cannot merge aggregates of different number backends!");
+		unsigned long long total = count + other.count;
+		double delta = other.mean - mean;
+		mean += delta * other.count / total;
+		squaredDeviations += other.squaredDeviations + delta * delta * ((double)count * other.count / total);
+		count = total;
+		add(other.sum);
+		add(other.compensation);
+		minimum = fmin(minimum, other.minimum);
+		maximum = fmax(maximum, other.maximum);
+		quantiles.merge(other.quantiles);
+		if(exact != nullptr) exact->merge(*other.exact);
+	}
+
+	NumberBackend getNumberBackend() const
+	{
+		return numbers;
+	}
+
+	double getSum() const
+	{
+		return sum + compensation;
+	}
+
+	double getVariance() const
+	{
+		return count > 1 ? squaredDeviations / (count - 1) : numeric_limits<double>::quiet_NaN();
+	}
+
+	void print(ostream& out) const
+	{
+		const double fractions[] = {0.5, 0.9, 0.99, 0.999};
+		const char* labels[] = {"p50", "p90", "p99", "p99.9"};
+		const char* approximate = exact != nullptr ? " (double)" : "";
+		string text = "count: " + to_string(count) + "\nsum: ";
+		if(exact != nullptr) exact->appendSum(text);
+		else appendNumber(text, getSum());
+		text += "\nmean: ";
+		if(exact != nullptr) exact->appendMean(text);
+		else appendNumber(text, count != 0 ? mean : numeric_limits<double>::quiet_NaN());
+		text += "\nvariance";
+		text += approximate;
+		text += ": ";
+		appendNumber(text, getVariance());
+		text += "\nmin: ";
+		if(exact != nullptr) exact->appendMinimum(text);
+		else appendNumber(text, count != 0 ? minimum : numeric_limits<double>::quiet_NaN());
+		text += "\nmax: ";
+		if(exact != nullptr) exact->appendMaximum(text);
+		else appendNumber(text, count != 0 ? maximum : numeric_limits<double>::quiet_NaN());
+		for(size_t i = 0; i < sizeof(fractions) / sizeof(fractions[0]); i++)
+		{
+			text += '\n';
+			text += labels[i];
+			text += approximate;
+			text += ": ";
+			appendNumber(text, count != 0 ? fmin(fmax(quantiles.quantile(fractions[i]), minimum), maximum) : numeric_limits<double>::quiet_NaN());
+		}
+		text += '\n';
+		out << text;
+	}
+};
+
+size_t currentThreadShard()
+{
+	static atomic<size_t> nextShard(0);
+	thread_local size_t shard = nextShard++ % COUNTER_SHARDS;
+	return shard;
+}
+
+class ShardedCounter
+{
+protected:
+	struct alignas(CACHE_LINE_SIZE) Shard
+	{
+		atomic<unsigned long long> value;
+	};
+
+	Shard shards[COUNTER_SHARDS];
+
+public:
+	ShardedCounter()
+	{
+		for(size_t i = 0; i < COUNTER_SHARDS; i++)
+		{
+			shards[i].value.store(0, memory_order_relaxed);
+		}
+	}
+
+	ShardedCounter(const ShardedCounter&) = delete;
+	ShardedCounter& operator=(const ShardedCounter&) = delete;
+
+	void add(unsigned long long n)
+	{
+		shards[currentThreadShard()].value.fetch_add(n, memory_order_relaxed);
+	}
+
+	unsigned long long get() const
+	{
+		unsigned long long sum = 0;
+		for(size_t i = 0; i < COUNTER_SHARDS; i++)
+		{
+			sum += shards[i].value.load(memory_order_relaxed);
+		}
+		return sum;
+	}
+};
+
+class ThreadPool
+{
+protected:
+	struct alignas(CACHE_LINE_SIZE) WorkQueue
+	{
+		mutex lock;
+		deque<size_t> tasks;
+	};
+
+	vector<thread> workers;
+	WorkQueue* queues;
+	size_t numberOfQueues;
+	mutex stateLock;
+	condition_variable wake;
+	condition_variable finished;
+	const function<void(size_t)>* job;
+	size_t generation;
+	size_t activeWorkers;
+	atomic<size_t> remainingTasks;
+	bool stopping;
+
+	bool takeTask(size_t self, size_t& task)
+	{
+		for(size_t i = 0; i < numberOfQueues; i++)
+		{
+			WorkQueue& queue = queues[(self + i) % numberOfQueues];
+			lock_guard<mutex> guard(queue.lock);
+			if(queue.tasks.empty()) continue;
+			if(i == 0)
+			{
+				task = queue.tasks.front();
+				queue.tasks.pop_front();
+			}
+			else
+			{
+				task = queue.tasks.back();
+				queue.tasks.pop_back();
+			}
+			return true;
+		}
+		return false;
+	}
+
+	void work(size_t self, const function<void(size_t)>& current)
+	{
+		size_t task;
+		while(takeTask(self, task))
+		{
+			current(task);
+			if(remainingTasks.fetch_sub(1) == 1)
+			{
+				lock_guard<mutex> guard(stateLock);
+				finished.notify_all();
+			}
+		}
+	}
+
+	void workerLoop(size_t self)
+	{
+		size_t seenGeneration = 0;
+		unique_lock<mutex> guard(stateLock);
+		while(true)
+		{
+			wake.wait(guard, [&]{ return stopping || generation != seenGeneration; });
+			if(stopping) return;
+			seenGeneration = generation;
+			const function<void(size_t)>* current = job;
+			if(current == nullptr) continue;
+			activeWorkers++;
+			guard.unlock();
+			work(self, *current);
+			guard.lock();
+			if(--activeWorkers == 0) finished.notify_all();
+		}
+	}
+
+public:
+	ThreadPool(size_t numberOfThreads = 0): job(nullptr), generation(0), activeWorkers(0), remainingTasks(0), stopping(false)
+	{
+		if(numberOfThreads == 0) numberOfThreads = thread::hardware_concurrency();
+		if(numberOfThreads == 0) numberOfThreads = 1;
+		numberOfQueues = numberOfThreads;
+		queues = new WorkQueue[numberOfQueues];
+		for(size_t i = 1; i < numberOfThreads; i++)
+		{
+			workers.emplace_back(&ThreadPool::workerLoop, this, i);
+		}
+	}
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	~ThreadPool()
+	{
+		{
+			lock_guard<mutex> guard(stateLock);
+			stopping = true;
+		}
+		wake.notify_all();
+		for(size_t i = 0; i < workers.size(); i++)
+		{
+			workers[i].join();
+		}
+		delete[] queues;
+	}
+
+	size_t getNumberOfThreads() const
+	{
+		return numberOfQueues;
+	}
+
+	void run(size_t numberOfTasks, const function<void(size_t)>& task)
+	{
+		if(numberOfTasks == 0) return;
+		{
+			lock_guard<mutex> guard(stateLock);
+			for(size_t i = 0; i < numberOfQueues; i++)
+			{
+				lock_guard<mutex> queueGuard(queues[i].lock);
+				for(size_t j = i * numberOfTasks / numberOfQueues; j < (i + 1) * numberOfTasks / numberOfQueues; j++)
+				{
+					queues[i].tasks.push_back(j);
+				}
+			}
+			remainingTasks = numberOfTasks;
+			job = &task;
+			generation++;
+		}
+		wake.notify_all();
+		work(0, task);
+		unique_lock<mutex> guard(stateLock);
+		finished.wait(guard, [&]{ return remainingTasks == 0 && activeWorkers == 0; });
+		job = nullptr;
+	}
+};
+
+class ResultCache
+{
+protected:
+	struct Entry
+	{
+		string key;
+		double value;
+		unsigned char status;
+		bool referenced;
+	};
+
+	struct alignas(CACHE_LINE_SIZE) Shard
+	{
+		mutex lock;
+		unordered_map<string, size_t> index;
+		vector<Entry> entries;
+		size_t hand;
+	};
+
+	Shard shards[CACHE_SHARDS];
+	size_t capacity;
+	size_t capacityPerShard;
+	ShardedCounter hits;
+	ShardedCounter misses;
+
+	Shard& shardFor(const string& key)
+	{
+		return shards[hash<string>()(key) % CACHE_SHARDS];
+	}
+
+public:
+	ResultCache(size_t capacity): capacity(capacity)
+	{
+		capacityPerShard = (capacity + CACHE_SHARDS - 1) / CACHE_SHARDS;
+		if(capacityPerShard == 0) throwException("Cache capacity cannot be zero!");
+		for(size_t i = 0; i < CACHE_SHARDS; i++)
+		{
+			shards[i].hand = 0;
+		}
+	}
+
+	ResultCache(const ResultCache&) = delete;
+	ResultCache& operator=(const ResultCache&) = delete;
+
+	bool find(const string& key, double& value, unsigned char& status)
+	{
+		Shard& shard = shardFor(key);
+		{
+			lock_guard<mutex> guard(shard.lock);
+			unordered_map<string, size_t>::iterator found = shard.index.find(key);
+			if(found != shard.index.end())
+			{
+				Entry& entry = shard.entries[found->second];
+				entry.referenced = true;
+				value = entry.value;
+				status = entry.status;
+				hits.add(1);
+				return true;
+			}
+		}
+		misses.add(1);
+		return false;
+	}
+
+	void insert(const string& key, double value, unsigned char status)
+	{
+		Shard& shard = shardFor(key);
+		lock_guard<mutex> guard(shard.lock);
+		if(shard.index.count(key) != 0) return;
+		if(shard.entries.size() < capacityPerShard)
+		{
+			shard.index.emplace(key, shard.entries.size());
+			shard.entries.push_back({key, value, status, false});
+			return;
+		}
+		while(shard.entries[shard.hand].referenced)
+		{
+			shard.entries[shard.hand].referenced = false;
+			shard.hand = (shard.hand + 1) % capacityPerShard;
+		}
+		Entry& victim = shard.entries[shard.hand];
+		shard.index.erase(victim.key);
+		victim.key = key;
+		victim.value = value;
+		victim.status = status;
+		shard.index.emplace(key, shard.hand);
+		shard.hand = (shard.hand + 1) % capacityPerShard;
+	}
+
+	size_t getCapacity() const
+	{
+		return capacity;
+	}
+
+	unsigned long long getNumberOfHits() const
+	{
+		return hits.get();
+	}
+
+	unsigned long long getNumberOfMisses() const
+	{
+		return misses.get();
+	}
+};
+
+class CalculatorMetrics
+{
+protected:
+	struct alignas(CACHE_LINE_SIZE) ThreadMetrics
+	{
+		atomic<unsigned long long> expressions;
+		atomic<unsigned long long> failures;
+		atomic<unsigned long long> operations[NUMBER_OF_METERED_OPCODES];
+		atomic<unsigned long long> errors[NUMBER_OF_STATUS_FLAGS];
+		atomic<unsigned long long> latencies[HISTOGRAM_BUCKETS];
+		atomic<unsigned long long> latencySum;
+		atomic<unsigned> sampleCountdown;
+
+		ThreadMetrics(): expressions(0), failures(0), latencySum(0), sampleCountdown(0)
+		{
+			for(size_t i = 0; i < NUMBER_OF_METERED_OPCODES; i++) operations[i].store(0, memory_order_relaxed);
+			for(size_t i = 0; i < NUMBER_OF_STATUS_FLAGS; i++) errors[i].store(0, memory_order_relaxed);
+			for(size_t i = 0; i < HISTOGRAM_BUCKETS; i++) latencies[i].store(0, memory_order_relaxed);
+		}
+	};
+
+	struct Snapshot
+	{
+		unsigned long long expressions;
+		unsigned long long failures;
+		unsigned long long operations[NUMBER_OF_METERED_OPCODES];
+		unsigned long long errors[NUMBER_OF_STATUS_FLAGS];
+		unsigned long long latencies[HISTOGRAM_BUCKETS];
+		unsigned long long latencySum;
+		unsigned long long latencySamples;
+	};
+
+	mutable mutex lock;
+	vector<ThreadMetrics*> threads;
+	atomic<ThreadMetrics*> slots[COUNTER_SHARDS];
+
+	static void increment(atomic<unsigned long long>& counter, unsigned long long n = 1)
+	{
+		counter.fetch_add(n, memory_order_relaxed);
+	}
+
+	static const char* operatorLabel(size_t index)
+	{
+		const char* labels[NUMBER_OF_METERED_OPCODES] = {"+", "-", "*", "/", "**", "V", "call"};
+		return labels[index];
+	}
+
+	static const char* errorLabel(size_t index)
+	{
+		const char* labels[NUMBER_OF_STATUS_FLAGS] = {"divide_by_zero", "zero_to_power_of_zero", "negative_root_of_negative", "fractional_root_of_negative", "invalid_operator", "invalid_expression", "overflow", "not_exact"};
+		return labels[index];
+	}
+
+	// Log-linear buckets: exact below HISTOGRAM_SUB_BUCKETS ns, then
+	// HISTOGRAM_SUB_BUCKETS linear steps per power of two, as in HdrHistogram.
+	static size_t bucketOf(unsigned long long nanoseconds)
+	{
+		if(nanoseconds < HISTOGRAM_SUB_BUCKETS) return nanoseconds;
+		size_t exponent = 63 - __builtin_clzll(nanoseconds);
+		size_t bucket = (exponent - 3) * HISTOGRAM_SUB_BUCKETS + ((nanoseconds >> (exponent - 4)) & (HISTOGRAM_SUB_BUCKETS - 1));
+		return bucket < HISTOGRAM_BUCKETS ? bucket : HISTOGRAM_BUCKETS - 1;
+	}
+
+	static unsigned long long bucketUpperBound(size_t bucket)
+	{
+		if(bucket < HISTOGRAM_SUB_BUCKETS) return bucket;
+		size_t exponent = bucket / HISTOGRAM_SUB_BUCKETS + 3;
+		unsigned long long step = 1ULL << (exponent - 4);
+		return (1ULL << exponent) + (bucket % HISTOGRAM_SUB_BUCKETS + 1) * step - 1;
+	}
+
+	ThreadMetrics* registerThread(size_t shard)
+	{
+		lock_guard<mutex> guard(lock);
+		ThreadMetrics* local = slots[shard].load(memory_order_relaxed);
+		if(local != nullptr) return local;
+		threads.push_back(new ThreadMetrics());
+		slots[shard].store(threads.back(), memory_order_release);
+		return threads.back();
+	}
+
+	Snapshot snapshot() const
+	{
+		Snapshot total = {};
+		lock_guard<mutex> guard(lock);
+		for(const ThreadMetrics* local : threads)
+		{
+			total.expressions += local->expressions.load(memory_order_relaxed);
+			total.failures += local->failures.load(memory_order_relaxed);
+			for(size_t i = 0; i < NUMBER_OF_METERED_OPCODES; i++) total.operations[i] += local->operations[i].load(memory_order_relaxed);
+			for(size_t i = 0; i < NUMBER_OF_STATUS_FLAGS; i++) total.errors[i] += local->errors[i].load(memory_order_relaxed);
+			for(size_t i = 0; i < HISTOGRAM_BUCKETS; i++) total.latencies[i] += local->latencies[i].load(memory_order_relaxed);
+			total.latencySum += local->latencySum.load(memory_order_relaxed);
+		}
+		for(size_t i = 0; i < HISTOGRAM_BUCKETS; i++) total.latencySamples += total.latencies[i];
+		return total;
+	}
+
+	static unsigned long long quantile(const Snapshot& total, double fraction)
+	{
+		unsigned long long rank = (unsigned long long)ceil(fraction * total.latencySamples);
+		unsigned long long seen = 0;
+		for(size_t i = 0; i < HISTOGRAM_BUCKETS; i++)
+		{
+			seen += total.latencies[i];
+			if(seen >= rank && seen != 0) return bucketUpperBound(i);
+		}
+		return 0;
+	}
+
+public:
+	// Counters live in one slot per thread shard, as in ShardedCounter. A
+	// slot is only shared when more threads than COUNTER_SHARDS have used
+	// the metrics, so updates are relaxed and uncontended in practice. A
+	// shared slot may skip or repeat a latency sample, but loses no counts.
+	struct NullRecorder
+	{
+		void operation(unsigned char) {}
+		void finish(unsigned char) {}
+	};
+
+	class Recorder
+	{
+	protected:
+		ThreadMetrics* local;
+		chrono::steady_clock::time_point start;
+		bool sampled;
+
+	public:
+		Recorder(ThreadMetrics* local): local(local), sampled(false)
+		{
+			unsigned countdown = local->sampleCountdown.load(memory_order_relaxed);
+			local->sampleCountdown.store(countdown != 0 ? countdown - 1 : LATENCY_SAMPLE_INTERVAL - 1, memory_order_relaxed);
+			if(countdown == 0)
+			{
+				sampled = true;
+				start = chrono::steady_clock::now();
+			}
+		}
+
+		void operation(unsigned char opcode)
+		{
+			increment(local->operations[opcode - OPCODE_ADD]);
+		}
+
+		void finish(unsigned char status)
+		{
+			increment(local->expressions);
+			if(status != STATUS_OK)
+			{
+				increment(local->failures);
+				for(size_t i = 0; i < NUMBER_OF_STATUS_FLAGS; i++)
+				{
+					if(status & (1 << i)) increment(local->errors[i]);
+				}
+			}
+			if(sampled)
+			{
+				unsigned long long elapsed = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+				increment(local->latencies[bucketOf(elapsed)]);
+				increment(local->latencySum, elapsed);
+			}
+		}
+	};
+
+	CalculatorMetrics()
+	{
+		for(size_t i = 0; i < COUNTER_SHARDS; i++)
+		{
+			slots[i].store(nullptr, memory_order_relaxed);
+		}
+	}
+
+	CalculatorMetrics(const CalculatorMetrics&) = delete;
+	CalculatorMetrics& operator=(const CalculatorMetrics&) = delete;
+
+	~CalculatorMetrics()
+	{
+		for(ThreadMetrics* local : threads)
+		{
+			delete local;
+		}
+	}
+
+	ThreadMetrics* local()
+	{
+		size_t shard = currentThreadShard();
+		ThreadMetrics* local = slots[shard].load(memory_order_acquire);
+		return local != nullptr ? local : registerThread(shard);
+	}
+
+	void exportPrometheus(ostream& out) const
+	{
+		Snapshot total = snapshot();
+		out << "# HELP calculator_expressions_total Expressions evaluated.\n# TYPE calculator_expressions_total counter\n";
+		out << "calculator_expressions_total " << total.expressions << "\n";
+		out << "# HELP calculator_failures_total Expressions that failed.\n# TYPE calculator_failures_total counter\n";
+		out << "calculator_failures_total " << total.failures << "\n";
+		out << "# HELP calculator_operations_total Operator executions.\n# TYPE calculator_operations_total counter\n";
+		for(size_t i = 0; i < NUMBER_OF_METERED_OPCODES; i++)
+		{
+			out << "calculator_operations_total{operator=\"" << operatorLabel(i) << "\"} " << total.operations[i] << "\n";
+		}
+		out << "# HELP calculator_errors_total Failures by cause.\n# TYPE calculator_errors_total counter\n";
+		for(size_t i = 0; i < NUMBER_OF_STATUS_FLAGS; i++)
+		{
+			out << "calculator_errors_total{error=\"" << errorLabel(i) << "\"} " << total.errors[i] << "\n";
+		}
+		out << "# HELP calculator_expression_latency_seconds Sampled latency of whole expressions.\n# TYPE calculator_expression_latency_seconds histogram\n";
+		unsigned long long cumulative = 0;
+		for(size_t i = 0; i < HISTOGRAM_BUCKETS; i++)
+		{
+			if(total.latencies[i] == 0) continue;
+			cumulative += total.latencies[i];
+			out << "calculator_expression_latency_seconds_bucket{le=\"" << (bucketUpperBound(i) + 1) * 1e-9 << "\"} " << cumulative << "\n";
+		}
+		out << "calculator_expression_latency_seconds_bucket{le=\"+Inf\"} " << total.latencySamples << "\n";
+		out << "calculator_expression_latency_seconds_sum " << total.latencySum * 1e-9 << "\n";
+		out << "calculator_expression_latency_seconds_count " << total.latencySamples << "\n";
+	}
+
+	void exportJson(ostream& out) const
+	{
+		Snapshot total = snapshot();
+		out << "{\"expressions\": " << total.expressions << ", \"failures\": " << total.failures << ", \"operations\": {";
+		for(size_t i = 0; i < NUMBER_OF_METERED_OPCODES; i++)
+		{
+			out << (i == 0 ? "" : ", ") << "\"" << operatorLabel(i) << "\": " << total.operations[i];
+		}
+		out << "}, \"errors\": {";
+		for(size_t i = 0; i < NUMBER_OF_STATUS_FLAGS; i++)
+		{
+			out << (i == 0 ? "" : ", ") << "\"" << errorLabel(i) << "\": " << total.errors[i];
+		}
+		out << "}, \"latency_ns\": {\"samples\": " << total.latencySamples << ", \"sum\": " << total.latencySum;
+		out << ", \"p50\": " << quantile(total, 0.5) << ", \"p90\": " << quantile(total, 0.9) << ", \"p99\": " << quantile(total, 0.99) << ", \"p999\": " << quantile(total, 0.999) << "}}";
+	}
+
+	void exportTo(ostream& out, bool json) const
+	{
+		if(json) exportJson(out);
+		else exportPrometheus(out);
+		out << endl;
+	}
+};
+
+class BatchInput
+{
+protected:
+	int descriptor;
+	const char* mapping;
+	size_t mappingSize;
+	size_t position;
+	size_t released;
+	char* buffer;
+	size_t buffered;
+	size_t consumed;
+	bool endOfInput;
+
+	bool nextMappedBlock(const char*& begin, const char*& end)
+	{
+		if(position == mappingSize) return false;
+		if(position - released >= BATCH_INPUT_BLOCK_SIZE * 4)
+		{
+			size_t page = sysconf(_SC_PAGESIZE);
+			size_t releaseEnd = position / page * page;
+			madvise((void*)(mapping + released), releaseEnd - released, MADV_DONTNEED);
+			released = releaseEnd;
+		}
+		begin = mapping + position;
+		size_t remaining = mappingSize - position;
+		if(remaining <= BATCH_INPUT_BLOCK_SIZE)
+		{
+			end = mapping + mappingSize;
+		}
+		else
+		{
+			end = find(begin + BATCH_INPUT_BLOCK_SIZE, mapping + mappingSize, '\n');
+			if(end < mapping + mappingSize) end++;
+		}
+		position = end - mapping;
+		return true;
+	}
+
+	bool nextReadBlock(const char*& begin, const char*& end)
+	{
+		copy(buffer + consumed, buffer + buffered, buffer);
+		buffered -= consumed;
+		consumed = 0;
+		while(!endOfInput && buffered < BATCH_INPUT_BLOCK_SIZE)
+		{
+			ssize_t count = read(descriptor, buffer + buffered, BATCH_INPUT_BLOCK_SIZE - buffered);
+			if(count < 0 && errno == EINTR) continue;
+			if(count < 0) throwException("Cannot read batch input!");
+			if(count == 0) endOfInput = true;
+			buffered += count;
+		}
+		if(buffered == 0) return false;
+		size_t blockEnd = buffered;
+		if(!endOfInput)
+		{
+			while(blockEnd > 0 && buffer[blockEnd - 1] != '\n') blockEnd--;
+			if(blockEnd == 0) throwException("Batch input line exceeds block size!");
+		}
+		begin = buffer;
+		end = buffer + blockEnd;
+		consumed = blockEnd;
+		return true;
+	}
+
+public:
+	BatchInput(const char* path): mapping(nullptr), mappingSize(0), position(0), released(0), buffer(nullptr), buffered(0), consumed(0), endOfInput(false)
+	{
+		descriptor = string(path) == "-" ? STDIN_FILENO : open(path, O_RDONLY);
+		if(descriptor < 0) throwException("Cannot open batch input file!");
+		struct stat information;
+		if(fstat(descriptor, &information) == 0 && S_ISREG(information.st_mode) && information.st_size > 0)
+		{
+			void* mapped = mmap(nullptr, information.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+			if(mapped != MAP_FAILED)
+			{
+				mapping = (const char*)mapped;
+				mappingSize = information.st_size;
+				madvise(mapped, mappingSize, MADV_SEQUENTIAL);
+				return;
+			}
+		}
+		buffer = new char[BATCH_INPUT_BLOCK_SIZE];
+	}
+
+	BatchInput(const BatchInput&) = delete;
+	BatchInput& operator=(const BatchInput&) = delete;
+
+	~BatchInput()
+	{
+		if(mapping != nullptr) munmap((void*)mapping, mappingSize);
+		delete[] buffer;
+		if(descriptor != STDIN_FILENO) close(descriptor);
+	}
+
+	bool isMapped() const
+	{
+		return mapping != nullptr;
+	}
+
+	bool nextBlock(const char*& begin, const char*& end)
+	{
+		return mapping != nullptr ? nextMappedBlock(begin, end) : nextReadBlock(begin, end);
+	}
+
+	static void sliceLines(const char* begin, const char* end, size_t sliceSize, vector<const char*>& starts)
+	{
+		starts.clear();
+		while(begin < end)
+		{
+			starts.push_back(begin);
+			begin = (size_t)(end - begin) > sliceSize ? find(begin + sliceSize, end, '\n') : end;
+			if(begin < end) begin++;
+		}
+		starts.push_back(end);
+	}
+};
+
+// Columnar batch format, all fields little-endian:
+//   char magic[4] = "CCOL"; uint32 version; uint32 numberOfColumns; uint32 reserved;
+//   numberOfColumns x { uint32 nameLength; char name[nameLength]; }
+//   zero padding to a multiple of 8 bytes;
+//   row groups: { uint64 numberOfRows; double column[numberOfColumns][numberOfRows]; }
+// A group of zero rows, or the end of the file, ends the stream. Every
+// column starts 8-byte aligned, so mapped files are read without copying.
+class ColumnarReader
+{
+protected:
+	int descriptor;
+	const unsigned char* mapping;
+	size_t mappingSize;
+	size_t position;
+	vector<string> names;
+	vector<double> buffer;
+
+	bool readFully(void* destination, size_t size)
+	{
+		if(mapping != nullptr)
+		{
+			size_t remaining = mappingSize - position;
+			if(remaining < size)
+			{
+				if(remaining != 0) throwException("Columnar input is truncated!");
+				return false;
+			}
+			memcpy(destination, mapping + position, size);
+			position += size;
+			return true;
+		}
+		size_t done = 0;
+		while(done < size)
+		{
+			ssize_t count = read(descriptor, (char*)destination + done, size - done);
+			if(count < 0 && errno == EINTR) continue;
+			if(count < 0) throwException("Cannot read columnar input!");
+			if(count == 0) break;
+			done += count;
+		}
+		if(done != 0 && done != size) throwException("Columnar input is truncated!");
+		return done == size;
+	}
+
+	template<typename Integer>
+	Integer readInteger()
+	{
+		Integer value;
+		if(!readFully(&value, sizeof(value))) throwException("Columnar input is truncated!");
+		return value;
+	}
+
+public:
+	ColumnarReader(const char* path): mapping(nullptr), mappingSize(0), position(0)
+	{
+		if(__BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__) throwException("Columnar format needs a little-endian host!");
+		descriptor = string(path) == "-" ? STDIN_FILENO : open(path, O_RDONLY);
+		if(descriptor < 0) throwException("Cannot open columnar input file!");
+		struct stat information;
+		if(fstat(descriptor, &information) == 0 && S_ISREG(information.st_mode) && information.st_size > 0)
+		{
+			void* mapped = mmap(nullptr, information.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+			if(mapped != MAP_FAILED)
+			{
+				mapping = (const unsigned char*)mapped;
+				mappingSize = information.st_size;
+				madvise(mapped, mappingSize, MADV_SEQUENTIAL);
+			}
+		}
+		char magic[4];
+		if(!readFully(magic, sizeof(magic)) || memcmp(magic, COLUMNAR_MAGIC, sizeof(magic)) != 0) throwException("Input is not in columnar format!");
+		if(readInteger<uint32_t>() != COLUMNAR_VERSION) throwException("Unsupported columnar format version!");
+		uint32_t numberOfColumns = readInteger<uint32_t>();
+		readInteger<uint32_t>();
+		size_t headerSize = 16;
+		for(uint32_t i = 0; i < numberOfColumns; i++)
+		{
+			uint32_t length = readInteger<uint32_t>();
+			if(length > MAX_NAME_LENGTH) throwException("Columnar column name is too long!");
+			string name(length, '\0');
+			if(length != 0 && !readFully(&name[0], length)) throwException("Columnar input is truncated!");
+			names.push_back(name);
+			headerSize += 4 + length;
+		}
+		char padding[8];
+		if(headerSize % 8 != 0 && !readFully(padding, 8 - headerSize % 8)) throwException("Columnar input is truncated!");
+	}
+
+	ColumnarReader(const ColumnarReader&) = delete;
+	ColumnarReader& operator=(const ColumnarReader&) = delete;
+
+	~ColumnarReader()
+	{
+		if(mapping != nullptr) munmap((void*)mapping, mappingSize);
+		if(descriptor != STDIN_FILENO) close(descriptor);
+	}
+
+	size_t getNumberOfColumns() const
+	{
+		return names.size();
+	}
+
+	const string& getColumnName(size_t index) const
+	{
+		return names[index];
+	}
+
+	int findColumn(const string& name) const
+	{
+		for(size_t i = 0; i < names.size(); i++)
+		{
+			if(names[i] == name) return i;
+		}
+		return -1;
+	}
+
+	// Points columns at the next row group, straight into the mapping when
+	// the input is a regular file. The pointers stay valid until the next call.
+	bool nextGroup(vector<const double*>& columns, size_t& rows)
+	{
+		uint64_t count;
+		if(!readFully(&count, sizeof(count)) || count == 0) return false;
+		if(count > COLUMNAR_MAX_GROUP_ROWS) throwException("Columnar row group is too large!");
+		rows = count;
+		size_t bytes = rows * names.size() * sizeof(double);
+		columns.resize(names.size());
+		const double* data;
+		if(mapping != nullptr)
+		{
+			if(mappingSize - position < bytes) throwException("Columnar input is truncated!");
+			data = (const double*)(mapping + position);
+			position += bytes;
+		}
+		else
+		{
+			buffer.resize(rows * names.size());
+			if(bytes != 0 && !readFully(buffer.data(), bytes)) throwException("Columnar input is truncated!");
+			data = buffer.data();
+		}
+		for(size_t i = 0; i < names.size(); i++)
+		{
+			columns[i] = data + i * rows;
+		}
+		return true;
+	}
+};
+
+class ColumnarWriter
+{
+protected:
+	ostream& out;
+	size_t numberOfColumns;
+
+	template<typename Integer>
+	void writeInteger(Integer value)
+	{
+		out.write((const char*)&value, sizeof(value));
+	}
+
+public:
+	ColumnarWriter(ostream& out, const vector<string>& names): out(out), numberOfColumns(names.size())
+	{
+		if(__BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__) throwException("Columnar format needs a little-endian host!");
+		out.write(COLUMNAR_MAGIC, 4);
+		writeInteger<uint32_t>(COLUMNAR_VERSION);
+		writeInteger<uint32_t>(names.size());
+		writeInteger<uint32_t>(0);
+		size_t headerSize = 16;
+		for(const string& name : names)
+		{
+			writeInteger<uint32_t>(name.size());
+			out.write(name.data(), name.size());
+			headerSize += 4 + name.size();
+		}
+		const char padding[8] = {};
+		if(headerSize % 8 != 0) out.write(padding, 8 - headerSize % 8);
+	}
+
+	void writeGroup(const double* const* columns, size_t rows)
+	{
+		if(rows == 0) return;
+		writeInteger<uint64_t>(rows);
+		for(size_t i = 0; i < numberOfColumns; i++)
+		{
+			out.write((const char*)columns[i], rows * sizeof(double));
+		}
+	}
+
+	void finish()
+	{
+		writeInteger<uint64_t>(0);
+		out.flush();
+		if(!out) throwException("Cannot write columnar output!");
+	}
+};
+
+template<typename... Operations>
+struct Pipeline;
+
+template<>
+struct Pipeline<>
+{
+	static constexpr size_t numberOfOperands = 1;
+
+	static constexpr double evaluate(const double n)
+	{
+		return n;
+	}
+};
+
+template<typename First, typename... Rest>
+struct Pipeline<First, Rest...>
+{
+	static constexpr size_t numberOfOperands = sizeof...(Rest) + 2;
+
+	template<typename... Operands>
+	static constexpr double evaluate(const double n1, const double n2, const Operands... rest)
+	{
+		return Pipeline<Rest...>::evaluate(First::apply(n1, n2), rest...);
+	}
+
+	static void evaluateColumns(const double* const* columns, double* results, size_t n)
+	{
+		evaluateColumns(columns, results, n, make_index_sequence<numberOfOperands>());
+	}
+
+private:
+	template<size_t... Indices>
+	static void evaluateColumns(const double* const* columns, double* results, size_t n, index_sequence<Indices...>)
+	{
+		for(size_t i = 0; i < n; i++)
+		{
+			results[i] = evaluate(columns[Indices][i]...);
+		}
+	}
+};
+
+bool isVariableName(const char* token, size_t length)
+{
+	if(length == 0 || isdigit((unsigned char)token[0])) return false;
+	for(size_t i = 0; i < length; i++)
+	{
+		if(!isalnum((unsigned char)token[i]) && token[i] != '_') return false;
+	}
+	return true;
+}
+
+class OperationArena
+{
+protected:
+	struct alignas(max_align_t) Slot
+	{
+		unsigned char bytes[OPERATION_SLOT_SIZE];
+	};
+
+	Slot slots[INLINE_OPERATION_SLOTS];
+	vector<unique_ptr<Slot[]>> chunks;
+	vector<Operation*> operations;
+
+public:
+	OperationArena() {};
+
+	OperationArena(const OperationArena&) = delete;
+	OperationArena& operator=(const OperationArena&) = delete;
+
+	~OperationArena()
+	{
+		clear();
+	}
+
+	// Slots never move once handed out: past the inline ones, storage grows
+	// in fixed chunks so dispatch tables can keep raw pointers.
+	void* allocate()
+	{
+		size_t index = operations.size();
+		if(index < INLINE_OPERATION_SLOTS) return slots[index].bytes;
+		index -= INLINE_OPERATION_SLOTS;
+		if(index / OPERATION_CHUNK_SLOTS == chunks.size()) chunks.emplace_back(new Slot[OPERATION_CHUNK_SLOTS]);
+		return chunks[index / OPERATION_CHUNK_SLOTS][index % OPERATION_CHUNK_SLOTS].bytes;
+	}
+
+	Operation* add(Operation* constructed)
+	{
+		operations.push_back(constructed);
+		return constructed;
+	}
+
+	Operation* add(const Operation& prototype)
+	{
+		return add(prototype.cloneInto(allocate()));
+	}
+
+	void clear()
+	{
+		while(!operations.empty())
+		{
+			operations.back()->~Operation();
+			operations.pop_back();
+		}
+	}
+
+	size_t size() const
+	{
+		return operations.size();
+	}
+
+	Operation* operator[](size_t index) const
+	{
+		return operations[index];
+	}
+};
+
+// A power or root whose exponent is a tape constant. The domain checks that
+// depend only on the exponent are resolved once, and the kernel is chosen
+// from the exponent instead of calling pow() for every row.
+struct PowerPlan
+{
+	enum Kind: unsigned char
+	{
+		KIND_INTEGER,
+		KIND_SQUARE_ROOT,
+		KIND_CUBE_ROOT,
+		KIND_GENERAL
+	};
+
+	Kind kind;
+	int integerExponent;
+	double exponent;
+	unsigned char zeroBaseStatus;
+	unsigned char negativeBaseStatus;
+
+	PowerPlan(Opcode opcode, double operand, bool fastMath = false)
+	{
+		zeroBaseStatus = STATUS_OK;
+		negativeBaseStatus = STATUS_OK;
+		if(opcode == OPCODE_POWER)
+		{
+			powerNumbers(0, operand, zeroBaseStatus);
+			exponent = operand;
+			kind = (fastMath ? isSmallInteger(operand) : isExactIntegerPower(operand)) ? KIND_INTEGER : KIND_GENERAL;
+		}
+		else
+		{
+			rootNumbers(-1, operand, negativeBaseStatus);
+			exponent = 1 / operand;
+			kind = operand == 2 ? KIND_SQUARE_ROOT : operand == 3 ? KIND_CUBE_ROOT : KIND_GENERAL;
+		}
+		integerExponent = kind == KIND_INTEGER ? (int)operand : 0;
+	}
+
+	double apply(const double n, unsigned char& status) const
+	{
+		unsigned char failure = (n == 0) * zeroBaseStatus | (n < 0) * negativeBaseStatus;
+		status |= failure;
+		if(failure != STATUS_OK) return numeric_limits<double>::quiet_NaN();
+		switch(kind)
+		{
+		case KIND_INTEGER:
+			return signedIntegerPower(n, integerExponent);
+		case KIND_SQUARE_ROOT:
+			return n > 0 ? sqrt(n) : pow(n, exponent);
+		case KIND_CUBE_ROOT:
+			return n > 0 ? cbrt(n) : pow(n, exponent);
+		default:
+			return pow(n, exponent);
+		}
+	}
+
+	void applyColumns(const double* a, double* out, unsigned char* status, size_t n) const
+	{
+		if(kind == KIND_INTEGER && zeroBaseStatus == STATUS_OK)
+		{
+			integerPowerColumns(a, out, integerExponent, n);
+			return;
+		}
+		for(size_t i = 0; i < n; i++)
+		{
+			out[i] = apply(a[i], status[i]);
+		}
+	}
+};
+
+#ifdef CALCULATOR_JIT
+double nativePower(const double n1, const double n2, unsigned char* status)
+{
+	return powerNumbers(n1, n2, *status);
+}
+
+double nativeRoot(const double n1, const double n2, unsigned char* status)
+{
+	return rootNumbers(n1, n2, *status);
+}
+
+double nativePowerConstant(const double n, const PowerPlan* plan, unsigned char* status)
+{
+	return plan->apply(n, *status);
+}
+
+// Translates a tape into x86-64 machine code. Stack slot d lives in xmm<d>
+// and xmm14/xmm15 are scratch. rbx holds the row, r12 the values or column
+// table, r13 the status bytes, and r14/r15 the results and row count of the
+// column loop; they are all callee-saved, so they survive calls into the
+// power kernels, around which the live slots are spilled to the frame.
+class NativeEmitter
+{
+protected:
+	enum Register
+	{
+		RAX = 0,
+		RCX = 1,
+		RDX = 2,
+		RBX = 3,
+		RSP = 4,
+		RBP = 5,
+		RSI = 6,
+		RDI = 7,
+		R12 = 12,
+		R13 = 13,
+		R14 = 14,
+		R15 = 15
+	};
+
+	vector<unsigned char> code;
+	vector<double> pool;
+	vector<pair<size_t, size_t>> poolFixups;
+	size_t frameSize;
+	bool fusedMultiplyAdd;
+
+	void byte(unsigned char value)
+	{
+		code.push_back(value);
+	}
+
+	void word(uint32_t value)
+	{
+		for(size_t i = 0; i < 4; i++) byte(value >> (8 * i));
+	}
+
+	void quad(uint64_t value)
+	{
+		for(size_t i = 0; i < 8; i++) byte(value >> (8 * i));
+	}
+
+	void modrm(unsigned char mode, unsigned char reg, unsigned char rm)
+	{
+		byte(mode << 6 | (reg & 7) << 3 | (rm & 7));
+	}
+
+	void rex(bool wide, unsigned char reg, unsigned char index, unsigned char base)
+	{
+		unsigned char prefix = 0x40 | wide << 3 | (reg >> 3) << 2 | (index >> 3) << 1 | base >> 3;
+		if(prefix != 0x40) byte(prefix);
+	}
+
+	void prefixed(unsigned char prefix, unsigned char opcode, unsigned char reg, unsigned char index, unsigned char base)
+	{
+		byte(prefix);
+		rex(false, reg, index, base);
+		byte(0x0F);
+		byte(opcode);
+	}
+
+	// op xmm<reg>, xmm<rm>
+	void sseRegister(unsigned char prefix, unsigned char opcode, unsigned char reg, unsigned char rm)
+	{
+		prefixed(prefix, opcode, reg, 0, rm);
+		modrm(3, reg, rm);
+	}
+
+	// op xmm<reg>, [base + offset]
+	void sseMemory(unsigned char prefix, unsigned char opcode, unsigned char reg, unsigned char base, size_t offset)
+	{
+		prefixed(prefix, opcode, reg, 0, base);
+		modrm(2, reg, base);
+		if((base & 7) == RSP) byte(0x24);
+		word(offset);
+	}
+
+	// op xmm<reg>, [base + index * 8]
+	void sseIndexed(unsigned char prefix, unsigned char opcode, unsigned char reg, unsigned char base, unsigned char index)
+	{
+		prefixed(prefix, opcode, reg, index, base);
+		bool displaced = (base & 7) == RBP;
+		modrm(displaced ? 1 : 0, reg, RSP);
+		byte(3 << 6 | (index & 7) << 3 | (base & 7));
+		if(displaced) byte(0);
+	}
+
+	// op xmm<reg>, [rip + constant]
+	void sseConstant(unsigned char prefix, unsigned char opcode, unsigned char reg, double value)
+	{
+		size_t index = 0;
+		while(index < pool.size() && bitsOf(pool[index]) != bitsOf(value)) index++;
+		if(index == pool.size()) pool.push_back(value);
+		prefixed(prefix, opcode, reg, 0, 0);
+		modrm(0, reg, RBP);
+		poolFixups.push_back(make_pair(code.size(), index));
+		word(0);
+	}
+
+	void move(unsigned char to, unsigned char from)
+	{
+		if(to != from) sseRegister(0x66, 0x28, to, from);
+	}
+
+	void spillSlot(unsigned char slot, bool restore)
+	{
+		sseMemory(0xF2, restore ? 0x10 : 0x11, slot, RSP, 8 * slot);
+	}
+
+	size_t savedOffset(size_t index) const
+	{
+		return 8 * (JIT_REGISTERS + index);
+	}
+
+	// [r13 + rbx], the current row's status byte.
+	void statusOperand(unsigned char reg)
+	{
+		modrm(1, reg, RSP);
+		byte((RBX & 7) << 3 | (R13 & 7));
+		byte(0);
+	}
+
+	void orStatus(unsigned char flag)
+	{
+		rex(false, 0, RBX, R13);
+		byte(0x80);
+		statusOperand(1);
+		byte(flag);
+	}
+
+	void clearStatus()
+	{
+		rex(false, 0, RBX, R13);
+		byte(0xC6);
+		statusOperand(0);
+		byte(STATUS_OK);
+	}
+
+	void loadStatusAddress(unsigned char reg)
+	{
+		rex(true, reg, RBX, R13);
+		byte(0x8D);
+		statusOperand(reg);
+	}
+
+	void moveImmediate(unsigned char reg, const void* value)
+	{
+		rex(true, 0, 0, reg);
+		byte(0xB8 | (reg & 7));
+		quad((uint64_t)value);
+	}
+
+	void moveRegister(unsigned char to, unsigned char from)
+	{
+		rex(true, from, 0, to);
+		byte(0x89);
+		modrm(3, from, to);
+	}
+
+	void call(const void* function)
+	{
+		moveImmediate(RAX, function);
+		byte(0xFF);
+		modrm(3, 2, RAX);
+	}
+
+	size_t jump(unsigned char condition)
+	{
+		if(condition == 0) byte(0xE9);
+		else
+		{
+			byte(0x0F);
+			byte(condition);
+		}
+		word(0);
+		return code.size() - 4;
+	}
+
+	void patch(size_t position, size_t target)
+	{
+		uint32_t displacement = target - (position + 4);
+		memcpy(&code[position], &displacement, 4);
+	}
+
+	// Calls function(slot, slot + 1, status) and leaves the result in slot.
+	void callBinary(unsigned char slot, const void* function)
+	{
+		for(unsigned char i = 0; i < slot; i++) spillSlot(i, false);
+		move(0, slot);
+		move(1, slot + 1);
+		loadStatusAddress(RDI);
+		call(function);
+		move(slot, 0);
+		for(unsigned char i = 0; i < slot; i++) spillSlot(i, true);
+	}
+
+	void callPowerConstant(unsigned char slot, const PowerPlan* plan)
+	{
+		for(unsigned char i = 0; i < slot; i++) spillSlot(i, false);
+		move(0, slot);
+		moveImmediate(RDI, plan);
+		loadStatusAddress(RSI);
+		call((const void*)nativePowerConstant);
+		move(slot, 0);
+		for(unsigned char i = 0; i < slot; i++) spillSlot(i, true);
+	}
+
+	// Repeats integerPower()'s multiplications in the same order, so the
+	// result is bit-identical to the interpreter's.
+	void integerPower(unsigned char slot, int exponent)
+	{
+		unsigned bits = exponent < 0 ? -exponent : exponent;
+		if(bits == 0)
+		{
+			sseConstant(0xF2, 0x10, slot, 1);
+			return;
+		}
+		move(15, slot);
+		bool started = false;
+		while(bits != 0)
+		{
+			if(bits & 1)
+			{
+				if(started) sseRegister(0xF2, 0x59, 14, 15);
+				else move(14, 15);
+				started = true;
+			}
+			bits >>= 1;
+			if(bits != 0) sseRegister(0xF2, 0x59, 15, 15);
+		}
+		if(exponent < 0)
+		{
+			sseConstant(0xF2, 0x10, slot, 1);
+			sseRegister(0xF2, 0x5E, slot, 14);
+		}
+		else move(slot, 14);
+	}
+
+	void divide(unsigned char slot)
+	{
+		sseRegister(0x66, 0x57, 15, 15);
+		sseRegister(0x66, 0x2E, slot + 1, 15);
+		size_t unordered = jump(0x8A);
+		size_t nonzero = jump(0x85);
+		orStatus(STATUS_DIVIDE_BY_ZERO);
+		sseConstant(0xF2, 0x10, slot, numeric_limits<double>::quiet_NaN());
+		size_t done = jump(0);
+		patch(unordered, code.size());
+		patch(nonzero, code.size());
+		sseRegister(0xF2, 0x5E, slot, slot + 1);
+		patch(done, code.size());
+	}
+
+	// VEX-encoded vfmadd/vfmsub on scalar doubles: slot (op)= slot + 1, slot + 2.
+	void fused(unsigned char opcode, unsigned char slot)
+	{
+		unsigned char second = slot + 1;
+		unsigned char third = slot + 2;
+		byte(0xC4);
+		byte((slot < 8) << 7 | 1 << 6 | (third < 8) << 5 | 0x02);
+		byte(0x80 | (~second & 15) << 3 | 0x01);
+		byte(opcode);
+		modrm(3, slot, third);
+	}
+
+	void loadVariable(unsigned char slot, size_t variable, bool columnar)
+	{
+		if(!columnar)
+		{
+			sseMemory(0xF2, 0x10, slot, R12, 8 * variable);
+			return;
+		}
+		rex(true, RAX, 0, R12);
+		byte(0x8B);
+		modrm(2, RAX, R12);
+		byte(0x24);
+		word(8 * variable);
+		sseIndexed(0xF2, 0x10, slot, RAX, RBX);
+	}
+
+	bool body(const vector<Instruction>& instructions, const vector<double>& constants, const vector<PowerPlan>& powers, bool columnar)
+	{
+		unsigned char top = 0;
+		for(const Instruction& instruction : instructions)
+		{
+			switch(instruction.opcode)
+			{
+			case OPCODE_LOAD_CONSTANT:
+				sseConstant(0xF2, 0x10, top++, constants[instruction.operand]);
+				break;
+			case OPCODE_LOAD_VARIABLE:
+				loadVariable(top++, instruction.operand, columnar);
+				break;
+			case OPCODE_LOAD_SAVED:
+				sseMemory(0xF2, 0x10, top++, RSP, savedOffset(instruction.operand));
+				break;
+			case OPCODE_STORE:
+				sseMemory(0xF2, 0x11, top - 1, RSP, savedOffset(instruction.operand));
+				break;
+			case OPCODE_ADD:
+				top--;
+				sseRegister(0xF2, 0x58, top - 1, top);
+				break;
+			case OPCODE_SUBTRACT:
+				top--;
+				sseRegister(0xF2, 0x5C, top - 1, top);
+				break;
+			case OPCODE_MULTIPLY:
+				top--;
+				sseRegister(0xF2, 0x59, top - 1, top);
+				break;
+			case OPCODE_DIVIDE:
+				top--;
+				divide(top - 1);
+				break;
+			case OPCODE_POWER:
+				top--;
+				callBinary(top - 1, (const void*)nativePower);
+				break;
+			case OPCODE_ROOT:
+				top--;
+				callBinary(top - 1, (const void*)nativeRoot);
+				break;
+			case OPCODE_POWER_CONSTANT:
+			{
+				const PowerPlan& plan = powers[instruction.operand];
+				if(plan.kind == PowerPlan::KIND_INTEGER && plan.zeroBaseStatus == STATUS_OK) integerPower(top - 1, plan.integerExponent);
+				else callPowerConstant(top - 1, &plan);
+				break;
+			}
+			case OPCODE_MULTIPLY_ADD:
+			case OPCODE_MULTIPLY_SUBTRACT:
+			case OPCODE_ADD_MULTIPLY:
+			case OPCODE_SUBTRACT_MULTIPLY:
+			{
+				if(!fusedMultiplyAdd) return false;
+				const unsigned char opcodes[] = {0xA9, 0xAB, 0xB9, 0xBD};
+				top -= 2;
+				fused(opcodes[instruction.opcode - OPCODE_MULTIPLY_ADD], top - 1);
+				break;
+			}
+			default:
+				return false;
+			}
+		}
+		return true;
+	}
+
+	void prologue()
+	{
+		byte(0x55);
+		byte(0x53);
+		for(unsigned char reg = R12; reg <= R15; reg++)
+		{
+			rex(false, 0, 0, reg);
+			byte(0x50 | (reg & 7));
+		}
+		rex(true, 0, 0, RSP);
+		byte(0x81);
+		modrm(3, 5, RSP);
+		word(frameSize);
+	}
+
+	void epilogue()
+	{
+		rex(true, 0, 0, RSP);
+		byte(0x81);
+		modrm(3, 0, RSP);
+		word(frameSize);
+		for(unsigned char reg = R15; reg >= R12; reg--)
+		{
+			rex(false, 0, 0, reg);
+			byte(0x58 | (reg & 7));
+		}
+		byte(0x5B);
+		byte(0x5D);
+		byte(0xC3);
+	}
+
+public:
+	NativeEmitter(size_t numberOfSavedValues): frameSize(8 * (JIT_REGISTERS + numberOfSavedValues)), fusedMultiplyAdd(__builtin_cpu_supports("fma"))
+	{
+		// Six pushes leave rsp 8 bytes off the 16-byte call alignment.
+		if(frameSize % 16 == 0) frameSize += 8;
+	}
+
+	size_t position() const
+	{
+		return code.size();
+	}
+
+	// double function(const double* values, unsigned char* status)
+	bool scalarFunction(const vector<Instruction>& instructions, const vector<double>& constants, const vector<PowerPlan>& powers)
+	{
+		prologue();
+		moveRegister(R12, RDI);
+		moveRegister(R13, RSI);
+		byte(0x31);
+		modrm(3, RBX, RBX);
+		if(!body(instructions, constants, powers, false)) return false;
+		epilogue();
+		return true;
+	}
+
+	// void function(const double* const* columns, double* results, unsigned char* statuses, size_t n)
+	bool columnFunction(const vector<Instruction>& instructions, const vector<double>& constants, const vector<PowerPlan>& powers)
+	{
+		prologue();
+		moveRegister(R12, RDI);
+		moveRegister(R14, RSI);
+		moveRegister(R13, RDX);
+		moveRegister(R15, RCX);
+		byte(0x31);
+		modrm(3, RBX, RBX);
+		rex(true, R15, 0, R15);
+		byte(0x85);
+		modrm(3, R15, R15);
+		size_t empty = jump(0x84);
+		size_t loop = code.size();
+		clearStatus();
+		if(!body(instructions, constants, powers, true)) return false;
+		sseIndexed(0xF2, 0x11, 0, R14, RBX);
+		rex(true, 0, 0, RBX);
+		byte(0xFF);
+		modrm(3, 0, RBX);
+		rex(true, R15, 0, RBX);
+		byte(0x39);
+		modrm(3, R15, RBX);
+		patch(jump(0x82), loop);
+		patch(empty, code.size());
+		epilogue();
+		return true;
+	}
+
+	// Appends the constant pool and resolves the rip-relative loads.
+	const vector<unsigned char>& finish()
+	{
+		while(code.size() % sizeof(double) != 0) byte(0xCC);
+		size_t start = code.size();
+		for(double value : pool) quad(bitsOf(value));
+		for(const pair<size_t, size_t>& fixup : poolFixups) patch(fixup.first, start + fixup.second * sizeof(double));
+		return code;
+	}
+};
+
+// Native code for one tape, in a private mapping that is made executable
+// only once it is fully written. Tapes it cannot translate, such as those
+// calling plugin operations, leave it uncompiled.
+class NativeExpression
+{
+protected:
+	typedef double (*ScalarFunction)(const double* values, unsigned char* status);
+	typedef void (*ColumnFunction)(const double* const* columns, double* results, unsigned char* statuses, size_t n);
+
+	vector<PowerPlan> powers;
+	void* memory;
+	size_t size;
+	ScalarFunction scalar;
+	ColumnFunction columns;
+
+public:
+	NativeExpression(const vector<Instruction>& instructions, const vector<double>& constants, const vector<PowerPlan>& powers, size_t maxStackDepth, size_t numberOfSavedValues): powers(powers), memory(MAP_FAILED), size(0), scalar(nullptr), columns(nullptr)
+	{
+		if(instructions.empty() || maxStackDepth > JIT_REGISTERS) return;
+		NativeEmitter emitter(numberOfSavedValues);
+		if(!emitter.scalarFunction(instructions, constants, this->powers)) return;
+		size_t columnStart = emitter.position();
+		if(!emitter.columnFunction(instructions, constants, this->powers)) return;
+		const vector<unsigned char>& code = emitter.finish();
+		memory = mmap(nullptr, code.size(), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if(memory == MAP_FAILED) return;
+		size = code.size();
+		memcpy(memory, code.data(), size);
+		if(mprotect(memory, size, PROT_READ | PROT_EXEC) != 0) return;
+		scalar = (ScalarFunction)memory;
+		columns = (ColumnFunction)((unsigned char*)memory + columnStart);
+	}
+
+	NativeExpression(const NativeExpression&) = delete;
+	NativeExpression& operator=(const NativeExpression&) = delete;
+
+	~NativeExpression()
+	{
+		if(memory != MAP_FAILED) munmap(memory, size);
+	}
+
+	bool isCompiled() const
+	{
+		return scalar != nullptr;
+	}
+
+	double evaluate(const double* values, unsigned char& status) const
+	{
+		return scalar(values, &status);
+	}
+
+	void evaluateColumns(const double* const* columns, double* results, unsigned char* statuses, size_t n) const
+	{
+		this->columns(columns, results, statuses, n);
+	}
+};
+
+// Counts evaluations of a tape and, once they pass JIT_THRESHOLD, swaps in
+// native code. The count is a relaxed load/store pair: a lost update only
+// delays promotion. Copies start cold, since their tape may still change.
+class ExpressionTier
+{
+protected:
+	atomic<size_t> evaluations;
+	atomic<const NativeExpression*> native;
+	mutex lock;
+	unique_ptr<NativeExpression> owned;
+
+public:
+	ExpressionTier(): evaluations(0), native(nullptr) {};
+
+	ExpressionTier(const ExpressionTier&): ExpressionTier() {};
+
+	ExpressionTier& operator=(const ExpressionTier&)
+	{
+		native.store(nullptr, memory_order_relaxed);
+		evaluations.store(0, memory_order_relaxed);
+		owned.reset();
+		return *this;
+	}
+
+	// Returns nullptr while the tape stays interpreted.
+	const NativeExpression* find(size_t count, const vector<Instruction>& instructions, const vector<double>& constants, const vector<PowerPlan>& powers, size_t maxStackDepth, size_t numberOfSavedValues)
+	{
+		const NativeExpression* code = native.load(memory_order_acquire);
+		if(code != nullptr) return code->isCompiled() ? code : nullptr;
+		size_t seen = evaluations.load(memory_order_relaxed) + count;
+		evaluations.store(seen, memory_order_relaxed);
+		if(seen < JIT_THRESHOLD) return nullptr;
+		lock_guard<mutex> guard(lock);
+		if(owned == nullptr)
+		{
+			owned.reset(new NativeExpression(instructions, constants, powers, maxStackDepth, numberOfSavedValues));
+			native.store(owned.get(), memory_order_release);
+		}
+		return owned->isCompiled() ? owned.get() : nullptr;
+	}
+};
+#endif
+
+class CompiledExpression
+{
+protected:
+	vector<Instruction> instructions;
+	vector<double> constants;
+	vector<PowerPlan> powers;
+	vector<Operation*> calls;
+	vector<CalculatorScalarKernel> kernels;
+	vector<string> variables;
+	size_t maxStackDepth;
+	size_t numberOfSavedValues;
+#ifdef CALCULATOR_JIT
+	mutable ExpressionTier tier;
+#endif
+
+	friend class Calculator;
+	friend class CalculatorBenchmark;
+	friend class CalculatorSelfTest;
+	friend class OpenClProgram;
+	friend class TapeCache;
+
+	struct Node
+	{
+		Instruction instruction;
+		size_t left;
+		size_t right;
+	};
+
+	static bool isLoad(unsigned char opcode)
+	{
+		return opcode == OPCODE_LOAD_CONSTANT || opcode == OPCODE_LOAD_VARIABLE || opcode == OPCODE_LOAD_SAVED;
+	}
+
+	void push(Opcode opcode, size_t operand, size_t& depth)
+	{
+		if(operand > numeric_limits<unsigned short>::max()) throwException("Expression is too long!");
+		instructions.push_back({(unsigned char)opcode, (unsigned short)operand});
+		if(isLoad(opcode))
+		{
+			if(++depth > MAX_STACK_DEPTH) throwException("Expression is too deeply nested!");
+			if(depth > maxStackDepth) maxStackDepth = depth;
+		}
+		else if(opcode != OPCODE_STORE && opcode != OPCODE_POWER_CONSTANT) depth--;
+	}
+
+	vector<Node> buildTree() const
+	{
+		vector<Node> nodes;
+		vector<size_t> stack;
+		size_t saved[MAX_SAVED_VALUES];
+		for(size_t i = 0; i < instructions.size(); i++)
+		{
+			const Instruction& instruction = instructions[i];
+			if(instruction.opcode == OPCODE_STORE)
+			{
+				saved[instruction.operand] = stack.back();
+				continue;
+			}
+			if(instruction.opcode == OPCODE_LOAD_SAVED)
+			{
+				stack.push_back(saved[instruction.operand]);
+				continue;
+			}
+			Node node = {instruction, 0, 0};
+			if(!isLoad(instruction.opcode))
+			{
+				node.right = stack.back();
+				stack.pop_back();
+				node.left = stack.back();
+				stack.pop_back();
+			}
+			stack.push_back(nodes.size());
+			nodes.push_back(node);
+		}
+		return nodes;
+	}
+
+	void emitTree(const vector<Node>& nodes, size_t root)
+	{
+		const size_t none = numeric_limits<size_t>::max();
+		vector<size_t> numbers(nodes.size());
+		map<tuple<unsigned char, unsigned long long, size_t, size_t>, size_t> numbering;
+		for(size_t i = 0; i < nodes.size(); i++)
+		{
+			const Node& node = nodes[i];
+			unsigned long long operand = node.instruction.operand;
+			if(node.instruction.opcode == OPCODE_LOAD_CONSTANT) operand = bitsOf(constants[node.instruction.operand]);
+			else if(node.instruction.opcode == OPCODE_CALL) operand = ((unsigned long long)i << 16) | operand;
+			bool leaf = isLoad(node.instruction.opcode);
+			tuple<unsigned char, unsigned long long, size_t, size_t> key(node.instruction.opcode, operand, leaf ? none : numbers[node.left], leaf ? none : numbers[node.right]);
+			numbers[i] = numbering.emplace(key, numbering.size()).first->second;
+		}
+		vector<size_t> uses(numbering.size(), 0);
+		vector<size_t> pending(1, root);
+		while(!pending.empty())
+		{
+			size_t node = pending.back();
+			pending.pop_back();
+			if(uses[numbers[node]]++ != 0 || isLoad(nodes[node].instruction.opcode)) continue;
+			pending.push_back(nodes[node].left);
+			pending.push_back(nodes[node].right);
+		}
+		instructions.clear();
+		maxStackDepth = 0;
+		numberOfSavedValues = 0;
+		size_t depth = 0;
+		vector<size_t> slots(numbering.size(), none);
+		vector<pair<size_t, bool>> work(1, make_pair(root, false));
+		while(!work.empty())
+		{
+			size_t node = work.back().first;
+			bool expanded = work.back().second;
+			work.pop_back();
+			size_t number = numbers[node];
+			const Instruction& instruction = nodes[node].instruction;
+			if(expanded)
+			{
+				push((Opcode)instruction.opcode, instruction.operand, depth);
+				if(uses[number] > 1 && numberOfSavedValues < MAX_SAVED_VALUES)
+				{
+					slots[number] = numberOfSavedValues++;
+					push(OPCODE_STORE, slots[number], depth);
+				}
+			}
+			else if(slots[number] != none) push(OPCODE_LOAD_SAVED, slots[number], depth);
+			else if(isLoad(instruction.opcode)) push((Opcode)instruction.opcode, instruction.operand, depth);
+			else
+			{
+				work.push_back(make_pair(node, true));
+				work.push_back(make_pair(nodes[node].right, false));
+				work.push_back(make_pair(nodes[node].left, false));
+			}
+		}
+	}
+
+	static double fold(unsigned char opcode, double n1, double n2, unsigned char& status)
+	{
+		return applyOpcode(opcode, n1, n2, status);
+	}
+
+	static bool hasExactReciprocal(double n)
+	{
+		int exponent;
+		return fabs(frexp(n, &exponent)) == 0.5 && isnormal(1 / n);
+	}
+
+	bool isConstant(const vector<Node>& nodes, size_t node, double& value) const
+	{
+		if(nodes[node].instruction.opcode != OPCODE_LOAD_CONSTANT) return false;
+		value = constants[nodes[node].instruction.operand];
+		return true;
+	}
+
+	size_t addConstant(vector<Node>& nodes, double value)
+	{
+		if(constants.size() > numeric_limits<unsigned short>::max()) throwException("Expression is too long!");
+		nodes.push_back({{(unsigned char)OPCODE_LOAD_CONSTANT, (unsigned short)constants.size()}, 0, 0});
+		constants.push_back(value);
+		return nodes.size() - 1;
+	}
+
+	// Returns the node that replaces nodes[index]. Only rewrites that give
+	// bit-identical results (signed zeros and NaNs included) are made, unless
+	// fastMath allows reassociation, x + 0 and division by a reciprocal.
+	size_t simplifyNode(vector<Node>& nodes, size_t index, bool fastMath)
+	{
+		unsigned char opcode = nodes[index].instruction.opcode;
+		size_t left = nodes[index].left;
+		size_t right = nodes[index].right;
+		double a, b;
+		bool leftConstant = isConstant(nodes, left, a);
+		bool rightConstant = isConstant(nodes, right, b);
+		if(opcode == OPCODE_CALL) return index;
+		if(leftConstant && rightConstant)
+		{
+			unsigned char status = STATUS_OK;
+			double value = fold(opcode, a, b, status);
+			if(status != STATUS_OK) return index;
+			return addConstant(nodes, value);
+		}
+		if(rightConstant)
+		{
+			bool positiveZero = b == 0 && !signbit(b);
+			bool negativeZero = b == 0 && signbit(b);
+			if(b == 1 && (opcode == OPCODE_MULTIPLY || opcode == OPCODE_DIVIDE || opcode == OPCODE_POWER || opcode == OPCODE_ROOT)) return left;
+			if(opcode == OPCODE_SUBTRACT && positiveZero) return left;
+			if(opcode == OPCODE_ADD && (negativeZero || (fastMath && positiveZero))) return left;
+			if(opcode == OPCODE_DIVIDE && b != 0 && (fastMath || hasExactReciprocal(b)))
+			{
+				opcode = OPCODE_MULTIPLY;
+				b = 1 / b;
+				nodes[index].instruction.opcode = opcode;
+				nodes[index].right = right = addConstant(nodes, b);
+			}
+			double c;
+			if(fastMath && (opcode == OPCODE_ADD || opcode == OPCODE_MULTIPLY) && nodes[left].instruction.opcode == opcode && isConstant(nodes, nodes[left].right, c))
+			{
+				unsigned char status = STATUS_OK;
+				nodes[index].right = addConstant(nodes, fold(opcode, c, b, status));
+				nodes[index].left = nodes[left].left;
+			}
+			return index;
+		}
+		if(leftConstant)
+		{
+			if(opcode == OPCODE_MULTIPLY && a == 1) return right;
+			if(opcode == OPCODE_ADD && a == 0 && (signbit(a) || fastMath)) return right;
+		}
+		return index;
+	}
+
+	// Rewrites reachable nodes children-first and returns them in postorder,
+	// the order emitTree expects, dropping anything the rewrites orphaned.
+	vector<Node> simplifyTree(vector<Node>& nodes, bool fastMath)
+	{
+		vector<size_t> forward(nodes.size());
+		size_t originalSize = nodes.size();
+		for(size_t i = 0; i < originalSize; i++)
+		{
+			forward[i] = i;
+			if(isLoad(nodes[i].instruction.opcode)) continue;
+			nodes[i].left = forward[nodes[i].left];
+			nodes[i].right = forward[nodes[i].right];
+			forward[i] = simplifyNode(nodes, i, fastMath);
+		}
+		const size_t none = numeric_limits<size_t>::max();
+		vector<size_t> placed(nodes.size(), none);
+		vector<Node> ordered;
+		vector<pair<size_t, bool>> work(1, make_pair(forward[originalSize - 1], false));
+		while(!work.empty())
+		{
+			size_t node = work.back().first;
+			bool expanded = work.back().second;
+			work.pop_back();
+			if(placed[node] != none) continue;
+			Node copy = nodes[node];
+			if(isLoad(copy.instruction.opcode) || expanded)
+			{
+				if(expanded)
+				{
+					copy.left = placed[copy.left];
+					copy.right = placed[copy.right];
+				}
+				placed[node] = ordered.size();
+				ordered.push_back(copy);
+				continue;
+			}
+			work.push_back(make_pair(node, true));
+			work.push_back(make_pair(copy.right, false));
+			work.push_back(make_pair(copy.left, false));
+		}
+		return ordered;
+	}
+
+	void optimize(bool fastMath)
+	{
+		if(instructions.empty()) return;
+		vector<Node> nodes = buildTree();
+		nodes = simplifyTree(nodes, fastMath);
+		emitTree(nodes, nodes.size() - 1);
+		specializePowers(fastMath);
+		if(fastMath) fuseMultiplyAdds();
+	}
+
+	static int stackEffect(unsigned char opcode)
+	{
+		if(isLoad(opcode)) return 1;
+		if(opcode == OPCODE_STORE || opcode == OPCODE_POWER_CONSTANT) return 0;
+		if(opcode >= OPCODE_MULTIPLY_ADD) return -2;
+		return -1;
+	}
+
+	// A fused multiply-add rounds once, so it only runs under fastMath. The
+	// product must not be stored for reuse; when it is the left operand the
+	// addend moves ahead of the fused instruction, which can deepen the
+	// stack by one, and the pass is dropped if that exceeds the limit.
+	void fuseMultiplyAdds()
+	{
+		vector<Instruction> fused;
+		vector<size_t> starts;
+		for(const Instruction& instruction : instructions)
+		{
+			unsigned char opcode = instruction.opcode;
+			int effect = stackEffect(opcode);
+			if(effect == 1) starts.push_back(fused.size());
+			if(effect >= 0)
+			{
+				fused.push_back(instruction);
+				continue;
+			}
+			size_t rightStart = starts.back();
+			starts.pop_back();
+			bool additive = opcode == OPCODE_ADD || opcode == OPCODE_SUBTRACT;
+			if(additive && fused.back().opcode == OPCODE_MULTIPLY)
+			{
+				fused.back().opcode = opcode == OPCODE_ADD ? OPCODE_ADD_MULTIPLY : OPCODE_SUBTRACT_MULTIPLY;
+				continue;
+			}
+			if(additive && fused[rightStart - 1].opcode == OPCODE_MULTIPLY)
+			{
+				fused.erase(fused.begin() + (rightStart - 1));
+				fused.push_back({(unsigned char)(opcode == OPCODE_ADD ? OPCODE_MULTIPLY_ADD : OPCODE_MULTIPLY_SUBTRACT), 0});
+				continue;
+			}
+			fused.push_back(instruction);
+		}
+		size_t depth = 0;
+		size_t deepest = 0;
+		for(const Instruction& instruction : fused)
+		{
+			depth += stackEffect(instruction.opcode);
+			deepest = max(deepest, depth);
+		}
+		if(deepest > MAX_STACK_DEPTH) return;
+		instructions = move(fused);
+		maxStackDepth = deepest;
+	}
+
+	// Runs after common subexpression elimination: the tree passes above
+	// only know binary operations.
+	// Squaring chains longer than isExactIntegerPower() allows round
+	// differently from pow(), so like fused multiply-adds they need fastMath.
+	void specializePowers(bool fastMath)
+	{
+		size_t kept = 0;
+		for(size_t i = 0; i < instructions.size(); i++)
+		{
+			Instruction instruction = instructions[i];
+			bool power = instruction.opcode == OPCODE_POWER || instruction.opcode == OPCODE_ROOT;
+			if(power && kept != 0 && instructions[kept - 1].opcode == OPCODE_LOAD_CONSTANT)
+			{
+				powers.push_back(PowerPlan((Opcode)instruction.opcode, constants[instructions[kept - 1].operand], fastMath));
+				instructions[kept - 1] = {(unsigned char)OPCODE_POWER_CONSTANT, (unsigned short)(powers.size() - 1)};
+				continue;
+			}
+			instructions[kept++] = instruction;
+		}
+		instructions.resize(kept);
+	}
+
+	void pushConstant(double value, size_t& depth)
+	{
+		push(OPCODE_LOAD_CONSTANT, constants.size(), depth);
+		constants.push_back(value);
+	}
+
+	void pushVariable(const char* name, size_t length, size_t& depth)
+	{
+		size_t index = 0;
+		while(index < variables.size() && variables[index].compare(0, string::npos, name, length) != 0) index++;
+		if(index == variables.size()) variables.push_back(string(name, length));
+		push(OPCODE_LOAD_VARIABLE, index, depth);
+	}
+
+	void pushOperation(Operation* operation, size_t& depth)
+	{
+		Opcode opcode = operation->getOpcode();
+		if(opcode != OPCODE_CALL)
+		{
+			push(opcode, 0, depth);
+			return;
+		}
+		size_t index = 0;
+		while(index < calls.size() && calls[index] != operation) index++;
+		if(index == calls.size())
+		{
+			calls.push_back(operation);
+			kernels.push_back(operation->getScalarKernel());
+		}
+		push(OPCODE_CALL, index, depth);
+	}
+
+public:
+	CompiledExpression(): maxStackDepth(0), numberOfSavedValues(0) {};
+
+	size_t getNumberOfVariables() const
+	{
+		return variables.size();
+	}
+
+	const string& getVariableName(size_t index) const
+	{
+		return variables[index];
+	}
+
+	int findVariable(const string& name) const
+	{
+		for(size_t i = 0; i < variables.size(); i++)
+		{
+			if(variables[i] == name) return i;
+		}
+		return -1;
+	}
+
+	size_t getNumberOfInstructions() const
+	{
+		return instructions.size();
+	}
+
+	const Instruction& getInstruction(size_t index) const
+	{
+		return instructions[index];
+	}
+
+	double evaluate(const double* values = nullptr) const
+	{
+		unsigned char status = STATUS_OK;
+		double result = evaluate(values, status);
+		assertSuccess(status);
+		return result;
+	}
+
+	double evaluate(const double* values, unsigned char& status) const
+	{
+#ifdef CALCULATOR_JIT
+		const NativeExpression* native = tier.find(1, instructions, constants, powers, maxStackDepth, numberOfSavedValues);
+		if(native != nullptr) return native->evaluate(values, status);
+#endif
+		return interpret(values, status);
+	}
+
+	double interpret(const double* values, unsigned char& status) const
+	{
+		double stack[MAX_STACK_DEPTH];
+		double saved[MAX_SAVED_VALUES];
+		size_t top = 0;
+		const Instruction* instruction = instructions.data();
+		const Instruction* end = instruction + instructions.size();
+		for(; instruction != end; instruction++)
+		{
+			switch(instruction->opcode)
+			{
+			case OPCODE_LOAD_CONSTANT:
+				stack[top++] = constants[instruction->operand];
+				break;
+			case OPCODE_LOAD_VARIABLE:
+				stack[top++] = values[instruction->operand];
+				break;
+			case OPCODE_ADD:
+				top--;
+				stack[top - 1] = addNumbers(stack[top - 1], stack[top]);
+				break;
+			case OPCODE_SUBTRACT:
+				top--;
+				stack[top - 1] = subtractNumbers(stack[top - 1], stack[top]);
+				break;
+			case OPCODE_MULTIPLY:
+				top--;
+				stack[top - 1] = multiplyNumbers(stack[top - 1], stack[top]);
+				break;
+			case OPCODE_DIVIDE:
+				top--;
+				stack[top - 1] = divideNumbers(stack[top - 1], stack[top], status);
+				break;
+			case OPCODE_POWER:
+				top--;
+				stack[top - 1] = powerNumbers(stack[top - 1], stack[top], status);
+				break;
+			case OPCODE_ROOT:
+				top--;
+				stack[top - 1] = rootNumbers(stack[top - 1], stack[top], status);
+				break;
+			case OPCODE_CALL:
+				top--;
+				if(kernels[instruction->operand] != nullptr) stack[top - 1] = kernels[instruction->operand](stack[top - 1], stack[top], &status);
+				else stack[top - 1] = calls[instruction->operand]->execute(stack[top - 1], stack[top], status);
+				break;
+			case OPCODE_STORE:
+				saved[instruction->operand] = stack[top - 1];
+				break;
+			case OPCODE_LOAD_SAVED:
+				stack[top++] = saved[instruction->operand];
+				break;
+			case OPCODE_POWER_CONSTANT:
+				stack[top - 1] = powers[instruction->operand].apply(stack[top - 1], status);
+				break;
+			case OPCODE_MULTIPLY_ADD:
+				top -= 2;
+				stack[top - 1] = fma(stack[top - 1], stack[top], stack[top + 1]);
+				break;
+			case OPCODE_MULTIPLY_SUBTRACT:
+				top -= 2;
+				stack[top - 1] = fma(stack[top - 1], stack[top], -stack[top + 1]);
+				break;
+			case OPCODE_ADD_MULTIPLY:
+				top -= 2;
+				stack[top - 1] = fma(stack[top], stack[top + 1], stack[top - 1]);
+				break;
+			case OPCODE_SUBTRACT_MULTIPLY:
+				top -= 2;
+				stack[top - 1] = fma(-stack[top], stack[top + 1], stack[top - 1]);
+				break;
+			}
+		}
+		return stack[0];
+	}
+
+	// Counts how many operands, starting with the one already on the stack,
+	// the same add, subtract or multiply at instructions[start] can take in a
+	// single pass: each further operand must be a plain load followed by the
+	// same operation.
+	size_t runLength(size_t start, const double* const* columns, const double* saved, size_t offset, const double* first, const double** operands, double* scalars) const
+	{
+		unsigned char opcode = instructions[start].opcode;
+		if(opcode != OPCODE_ADD && opcode != OPCODE_SUBTRACT && opcode != OPCODE_MULTIPLY) return 0;
+		operands[0] = first;
+		size_t run = 1;
+		for(size_t i = start + 1; run < COLUMN_RUN_LENGTH && i + 1 < instructions.size() && instructions[i + 1].opcode == opcode; i += 2, run++)
+		{
+			const Instruction& load = instructions[i];
+			if(load.opcode == OPCODE_LOAD_VARIABLE) operands[run] = columns[load.operand] + offset;
+			else if(load.opcode == OPCODE_LOAD_SAVED) operands[run] = saved + load.operand * COLUMN_BLOCK_SIZE;
+			else if(load.opcode == OPCODE_LOAD_CONSTANT)
+			{
+				operands[run] = nullptr;
+				scalars[run] = constants[load.operand];
+			}
+			else break;
+		}
+		return run;
+	}
+
+	void evaluateColumns(const double* const* columns, double* results, size_t n) const
+	{
+		evaluateColumns(columns, results, nullptr, n);
+	}
+
+	void evaluateColumns(const double* const* columns, double* results, unsigned char* statuses, size_t n) const
+	{
+#ifdef CALCULATOR_JIT
+		// The native loop runs one row at a time; on very short tapes the
+		// interpreter's vector kernels are as fast or faster.
+		const NativeExpression* native = nullptr;
+		if(instructions.size() >= JIT_COLUMN_INSTRUCTIONS) native = tier.find(n, instructions, constants, powers, maxStackDepth, numberOfSavedValues);
+		if(native != nullptr && statuses != nullptr)
+		{
+			native->evaluateColumns(columns, results, statuses, n);
+			return;
+		}
+		if(native != nullptr)
+		{
+			vector<unsigned char> status(n);
+			native->evaluateColumns(columns, results, status.data(), n);
+			assertSuccess(firstFailure(status.data(), n));
+			return;
+		}
+#endif
+		interpretColumns(columns, results, statuses, n);
+	}
+
+	void interpretColumns(const double* const* columns, double* results, unsigned char* statuses, size_t n) const
+	{
+		vector<double> scratch((maxStackDepth + numberOfSavedValues) * COLUMN_BLOCK_SIZE);
+		double* saved = &scratch[maxStackDepth * COLUMN_BLOCK_SIZE];
+		const double* stack[MAX_STACK_DEPTH];
+		const double* runOperands[COLUMN_RUN_LENGTH];
+		double runScalars[COLUMN_RUN_LENGTH];
+		unsigned char blockStatus[COLUMN_BLOCK_SIZE];
+		for(size_t offset = 0; offset < n; offset += COLUMN_BLOCK_SIZE)
+		{
+			size_t count = n - offset < COLUMN_BLOCK_SIZE ? n - offset : COLUMN_BLOCK_SIZE;
+			unsigned char* status = statuses != nullptr ? statuses + offset : blockStatus;
+			fill(status, status + count, STATUS_OK);
+			size_t top = 0;
+			for(size_t i = 0; i < instructions.size(); i++)
+			{
+				const Instruction& instruction = instructions[i];
+				if(instruction.opcode == OPCODE_LOAD_CONSTANT)
+				{
+					double* slot = &scratch[top * COLUMN_BLOCK_SIZE];
+					for(size_t j = 0; j < count; j++)
+					{
+						slot[j] = constants[instruction.operand];
+					}
+					stack[top++] = slot;
+					continue;
+				}
+				if(instruction.opcode == OPCODE_LOAD_VARIABLE)
+				{
+					stack[top++] = columns[instruction.operand] + offset;
+					continue;
+				}
+				if(instruction.opcode == OPCODE_STORE)
+				{
+					copy(stack[top - 1], stack[top - 1] + count, saved + instruction.operand * COLUMN_BLOCK_SIZE);
+					continue;
+				}
+				if(instruction.opcode == OPCODE_LOAD_SAVED)
+				{
+					stack[top++] = saved + instruction.operand * COLUMN_BLOCK_SIZE;
+					continue;
+				}
+				if(instruction.opcode == OPCODE_POWER_CONSTANT)
+				{
+					double* out = &scratch[(top - 1) * COLUMN_BLOCK_SIZE];
+					powers[instruction.operand].applyColumns(stack[top - 1], out, status, count);
+					stack[top - 1] = out;
+					continue;
+				}
+				if(instruction.opcode >= OPCODE_MULTIPLY_ADD)
+				{
+					top -= 2;
+					const double* x = stack[top - 1];
+					const double* y = stack[top];
+					const double* z = stack[top + 1];
+					double* out = &scratch[(top - 1) * COLUMN_BLOCK_SIZE];
+					switch(instruction.opcode)
+					{
+					case OPCODE_MULTIPLY_ADD:
+						multiplyAddColumns(x, y, z, out, count);
+						break;
+					case OPCODE_MULTIPLY_SUBTRACT:
+						multiplySubtractColumns(x, y, z, out, count);
+						break;
+					case OPCODE_ADD_MULTIPLY:
+						multiplyAddColumns(y, z, x, out, count);
+						break;
+					case OPCODE_SUBTRACT_MULTIPLY:
+						negatedMultiplyAddColumns(y, z, x, out, count);
+						break;
+					}
+					stack[top - 1] = out;
+					continue;
+				}
+				top--;
+				const double* a = stack[top - 1];
+				const double* b = stack[top];
+				double* out = &scratch[(top - 1) * COLUMN_BLOCK_SIZE];
+				size_t run = runLength(i, columns, saved, offset, b, runOperands, runScalars);
+				if(run > 1)
+				{
+					if(instruction.opcode == OPCODE_ADD) addRunColumns(a, runOperands, runScalars, run, out, count);
+					else if(instruction.opcode == OPCODE_SUBTRACT) subtractRunColumns(a, runOperands, runScalars, run, out, count);
+					else multiplyRunColumns(a, runOperands, runScalars, run, out, count);
+					stack[top - 1] = out;
+					i += 2 * (run - 1);
+					continue;
+				}
+				switch(instruction.opcode)
+				{
+				case OPCODE_ADD:
+					addColumns(a, b, out, status, count);
+					break;
+				case OPCODE_SUBTRACT:
+					subtractColumns(a, b, out, status, count);
+					break;
+				case OPCODE_MULTIPLY:
+					multiplyColumns(a, b, out, status, count);
+					break;
+				case OPCODE_DIVIDE:
+					divideColumns(a, b, out, status, count);
+					break;
+				case OPCODE_POWER:
+					powerColumns(a, b, out, status, count);
+					break;
+				case OPCODE_ROOT:
+					rootColumns(a, b, out, status, count);
+					break;
+				case OPCODE_CALL:
+					calls[instruction.operand]->executeBatch(a, b, out, status, count);
+					break;
+				}
+				stack[top - 1] = out;
+			}
+			for(size_t j = 0; j < count; j++)
+			{
+				results[offset + j] = stack[0][j];
+			}
+			if(statuses == nullptr) assertSuccess(firstFailure(status, count));
+		}
+	}
+};
+
+// Binds a compiled expression's variables to caller-owned data: contiguous
+// arrays, a double member of an array of row structs, or a single value
+// shared by every row. Strided sources are gathered a block at a time, so
+// the tape itself only ever sees contiguous columns.
+class ExpressionBinding
+{
+protected:
+	struct Source
+	{
+		const unsigned char* base;
+		size_t stride;
+	};
+
+	const CompiledExpression& expression;
+	vector<Source> sources;
+	vector<double> broadcast;
+	vector<bool> referenced;
+
+	Source& sourceFor(const string& name)
+	{
+		int index = expression.findVariable(name);
+		if(index < 0) throwException("Expression has no such variable!");
+		return sources[index];
+	}
+
+	void assertBound() const
+	{
+		for(size_t i = 0; i < sources.size(); i++)
+		{
+			if(referenced[i] && sources[i].base == nullptr) throwException("Unbound variable!");
+		}
+	}
+
+	double load(size_t variable, size_t index) const
+	{
+		return *(const double*)(sources[variable].base + index * sources[variable].stride);
+	}
+
+	bool isContiguous() const
+	{
+		for(size_t i = 0; i < sources.size(); i++)
+		{
+			if(referenced[i] && sources[i].stride != sizeof(double)) return false;
+		}
+		return true;
+	}
+
+public:
+	ExpressionBinding(const CompiledExpression& expression): expression(expression), sources(expression.getNumberOfVariables(), Source{nullptr, 0}), broadcast(expression.getNumberOfVariables()), referenced(expression.getNumberOfVariables(), false)
+	{
+		for(size_t i = 0; i < expression.getNumberOfInstructions(); i++)
+		{
+			const Instruction& instruction = expression.getInstruction(i);
+			if(instruction.opcode == OPCODE_LOAD_VARIABLE) referenced[instruction.operand] = true;
+		}
+	}
+
+	// Broadcast sources point into this binding's own storage.
+	ExpressionBinding(const ExpressionBinding&) = delete;
+	ExpressionBinding& operator=(const ExpressionBinding&) = delete;
+
+	ExpressionBinding& bind(const string& name, const double* values, size_t stride = sizeof(double))
+	{
+		sourceFor(name) = Source{(const unsigned char*)values, stride};
+		return *this;
+	}
+
+	template<typename Row>
+	ExpressionBinding& bind(const string& name, const Row* rows, const double Row::* member)
+	{
+		return bind(name, &(rows->*member), sizeof(Row));
+	}
+
+	ExpressionBinding& bind(const string& name, double value)
+	{
+		int index = expression.findVariable(name);
+		if(index < 0) throwException("Expression has no such variable!");
+		broadcast[index] = value;
+		sources[index] = Source{(const unsigned char*)&broadcast[index], 0};
+		return *this;
+	}
+
+	// The row is gathered per thread, so one binding can be shared by
+	// concurrent callers.
+	double evaluate(size_t index, unsigned char& status) const
+	{
+		thread_local vector<double> row;
+		assertBound();
+		row.resize(sources.size());
+		for(size_t i = 0; i < sources.size(); i++)
+		{
+			row[i] = referenced[i] ? load(i, index) : 0;
+		}
+		return expression.evaluate(row.data(), status);
+	}
+
+	double evaluate(size_t index) const
+	{
+		unsigned char status = STATUS_OK;
+		double result = evaluate(index, status);
+		assertSuccess(status);
+		return result;
+	}
+
+	void evaluate(double* results, unsigned char* statuses, size_t n) const
+	{
+		assertBound();
+		vector<const double*> columns(sources.size(), nullptr);
+		if(isContiguous())
+		{
+			for(size_t i = 0; i < sources.size(); i++)
+			{
+				columns[i] = (const double*)sources[i].base;
+			}
+			expression.evaluateColumns(columns.data(), results, statuses, n);
+			return;
+		}
+		vector<double> gathered(sources.size() * COLUMN_BLOCK_SIZE);
+		for(size_t offset = 0; offset < n; offset += COLUMN_BLOCK_SIZE)
+		{
+			size_t count = n - offset < COLUMN_BLOCK_SIZE ? n - offset : COLUMN_BLOCK_SIZE;
+			for(size_t i = 0; i < sources.size(); i++)
+			{
+				if(!referenced[i]) continue;
+				if(sources[i].stride == sizeof(double))
+				{
+					columns[i] = (const double*)sources[i].base + offset;
+					continue;
+				}
+				double* column = &gathered[i * COLUMN_BLOCK_SIZE];
+				for(size_t j = 0; j < count; j++)
+				{
+					column[j] = load(i, offset + j);
+				}
+				columns[i] = column;
+			}
+			expression.evaluateColumns(columns.data(), results + offset, statuses != nullptr ? statuses + offset : nullptr, count);
+		}
+	}
+
+	void evaluate(double* results, size_t n) const
+	{
+		evaluate(results, nullptr, n);
+	}
+};
+
+enum ColumnDevice: unsigned char
+{
+	COLUMN_DEVICE_CPU,
+	COLUMN_DEVICE_OPENCL,
+	COLUMN_DEVICE_AUTO
+};
+
+#ifdef CALCULATOR_OPENCL
+// The OpenCL library is opened at run time, so the build needs neither its
+// headers nor -lOpenCL, and hosts without a driver fall back to the CPU.
+// Only the handful of OpenCL 1.2 entry points used below are declared.
+class OpenClDevice
+{
+public:
+	typedef int32_t Status;
+	typedef struct OpaquePlatform* Platform;
+	typedef struct OpaqueDevice* Device;
+	typedef struct OpaqueContext* Context;
+	typedef struct OpaqueQueue* Queue;
+	typedef struct OpaqueProgram* Program;
+	typedef struct OpaqueKernel* Kernel;
+	typedef struct OpaqueMemory* Memory;
+	typedef struct OpaqueEvent* Event;
+
+	enum
+	{
+		SUCCESS = 0,
+		DEVICE_TYPE_GPU = 1 << 2,
+		DEVICE_TYPE_ACCELERATOR = 1 << 3,
+		DEVICE_DOUBLE_FP_CONFIG = 0x1032,
+		MEMORY_WRITE_ONLY = 1 << 1,
+		MEMORY_READ_ONLY = 1 << 2
+	};
+
+	Status (*getPlatformIDs)(uint32_t, Platform*, uint32_t*);
+	Status (*getDeviceIDs)(Platform, uint64_t, uint32_t, Device*, uint32_t*);
+	Status (*getDeviceInfo)(Device, uint32_t, size_t, void*, size_t*);
+	Context (*createContext)(const intptr_t*, uint32_t, const Device*, void (*)(const char*, const void*, size_t, void*), void*, Status*);
+	Queue (*createCommandQueue)(Context, Device, uint64_t, Status*);
+	Program (*createProgramWithSource)(Context, uint32_t, const char**, const size_t*, Status*);
+	Status (*buildProgram)(Program, uint32_t, const Device*, const char*, void (*)(Program, void*), void*);
+	Kernel (*createKernel)(Program, const char*, Status*);
+	Status (*setKernelArg)(Kernel, uint32_t, size_t, const void*);
+	Memory (*createBuffer)(Context, uint64_t, size_t, void*, Status*);
+	Status (*enqueueWriteBuffer)(Queue, Memory, uint32_t, size_t, size_t, const void*, uint32_t, const Event*, Event*);
+	Status (*enqueueReadBuffer)(Queue, Memory, uint32_t, size_t, size_t, void*, uint32_t, const Event*, Event*);
+	Status (*enqueueNDRangeKernel)(Queue, Kernel, uint32_t, const size_t*, const size_t*, const size_t*, uint32_t, const Event*, Event*);
+	Status (*flush)(Queue);
+	Status (*finish)(Queue);
+	Status (*waitForEvents)(uint32_t, const Event*);
+	Status (*releaseEvent)(Event);
+	Status (*releaseMemObject)(Memory);
+	Status (*releaseKernel)(Kernel);
+	Status (*releaseProgram)(Program);
+	Status (*releaseCommandQueue)(Queue);
+	Status (*releaseContext)(Context);
+
+protected:
+	void* library;
+	Device device;
+	Context context;
+
+	template<typename Function>
+	bool bind(Function& function, const char* name)
+	{
+		function = (Function)dlsym(library, name);
+		return function != nullptr;
+	}
+
+	bool bindAll()
+	{
+		return bind(getPlatformIDs, "clGetPlatformIDs") && bind(getDeviceIDs, "clGetDeviceIDs") && bind(getDeviceInfo, "clGetDeviceInfo")
+			&& bind(createContext, "clCreateContext") && bind(createCommandQueue, "clCreateCommandQueue")
+			&& bind(createProgramWithSource, "clCreateProgramWithSource") && bind(buildProgram, "clBuildProgram")
+			&& bind(createKernel, "clCreateKernel") && bind(setKernelArg, "clSetKernelArg")
+			&& bind(createBuffer, "clCreateBuffer") && bind(enqueueWriteBuffer, "clEnqueueWriteBuffer") && bind(enqueueReadBuffer, "clEnqueueReadBuffer")
+			&& bind(enqueueNDRangeKernel, "clEnqueueNDRangeKernel") && bind(flush, "clFlush") && bind(finish, "clFinish")
+			&& bind(waitForEvents, "clWaitForEvents") && bind(releaseEvent, "clReleaseEvent") && bind(releaseMemObject, "clReleaseMemObject")
+			&& bind(releaseKernel, "clReleaseKernel") && bind(releaseProgram, "clReleaseProgram")
+			&& bind(releaseCommandQueue, "clReleaseCommandQueue") && bind(releaseContext, "clReleaseContext");
+	}
+
+	// Takes the first GPU, or failing that accelerator, with double support.
+	bool chooseDevice()
+	{
+		Platform platforms[OPENCL_MAX_PLATFORMS];
+		uint32_t numberOfPlatforms = 0;
+		if(getPlatformIDs(OPENCL_MAX_PLATFORMS, platforms, &numberOfPlatforms) != SUCCESS) return false;
+		numberOfPlatforms = min<uint32_t>(numberOfPlatforms, OPENCL_MAX_PLATFORMS);
+		const uint64_t types[] = {DEVICE_TYPE_GPU, DEVICE_TYPE_ACCELERATOR};
+		for(uint64_t type : types)
+		{
+			for(uint32_t i = 0; i < numberOfPlatforms; i++)
+			{
+				Device devices[OPENCL_MAX_DEVICES];
+				uint32_t numberOfDevices = 0;
+				if(getDeviceIDs(platforms[i], type, OPENCL_MAX_DEVICES, devices, &numberOfDevices) != SUCCESS) continue;
+				for(uint32_t j = 0; j < min<uint32_t>(numberOfDevices, OPENCL_MAX_DEVICES); j++)
+				{
+					uint64_t doubleConfig = 0;
+					if(getDeviceInfo(devices[j], DEVICE_DOUBLE_FP_CONFIG, sizeof(doubleConfig), &doubleConfig, nullptr) != SUCCESS || doubleConfig == 0) continue;
+					device = devices[j];
+					return true;
+				}
+			}
+		}
+		return false;
+	}
+
+	OpenClDevice(): library(nullptr), device(nullptr), context(nullptr)
+	{
+		library = dlopen("libOpenCL.so.1", RTLD_NOW | RTLD_LOCAL);
+		if(library == nullptr) return;
+		Status status = SUCCESS;
+		if(bindAll() && chooseDevice()) context = createContext(nullptr, 1, &device, nullptr, nullptr, &status);
+		if(status != SUCCESS) context = nullptr;
+	}
+
+public:
+	OpenClDevice(const OpenClDevice&) = delete;
+	OpenClDevice& operator=(const OpenClDevice&) = delete;
+
+	// Returns nullptr when no usable device exists. The library stays loaded
+	// for the life of the process.
+	static OpenClDevice* get()
+	{
+		static OpenClDevice instance;
+		return instance.context != nullptr ? &instance : nullptr;
+	}
+
+	Device getDevice() const
+	{
+		return device;
+	}
+
+	Context getContext() const
+	{
+		return context;
+	}
+};
+
+// Builds one OpenCL kernel per compiled tape, with a work-item per row. The
+// built-in operations and their status flags are translated one for one;
+// tapes with plugin calls are left to the CPU. Add, subtract, multiply,
+// divide and square root are correctly rounded on the device, but pow and
+// cbrt are only accurate to a few ulps there.
+class OpenClProgram
+{
+protected:
+	OpenClDevice& api;
+	OpenClDevice::Program program;
+	OpenClDevice::Kernel kernel;
+	size_t numberOfVariables;
+
+	static string literal(double value)
+	{
+		char text[40];
+		snprintf(text, sizeof(text), "as_double(0x%016llxUL)", (unsigned long long)bitsOf(value));
+		return text;
+	}
+
+	static string helpers()
+	{
+		char text[4096];
+		snprintf(text, sizeof(text),
+			"#pragma OPENCL EXTENSION cl_khr_fp64 : enable\n"
+			"double divideNumbers(double a, double b, uchar* status) { if(b == 0) { *status |= %d; return NAN; } return a / b; }\n"
+			"double integerPower(double base, uint exponent) { double result = 1; while(exponent != 0) { if(exponent & 1) result *= base; exponent >>= 1; if(exponent != 0) base *= base; } return result; }\n"
+			"double signedIntegerPower(double base, int exponent) { return exponent < 0 ? 1 / integerPower(base, -exponent) : integerPower(base, exponent); }\n"
+			"double powerNumbers(double a, double b, uchar* status) { if(a == 0 && b == 0) { *status |= %d; return NAN; } if(b == 0 || b == 1) return signedIntegerPower(a, (int)b); return pow(a, b); }\n"
+			"double rootNumbers(double a, double b, uchar* status) { int negative = a < 0 && b < 0; int fractional = a < 0 && (int)b != b; *status |= (negative ? %d : 0) | (fractional ? %d : 0); if(negative || fractional) return NAN; if(a > 0 && b == 2) return sqrt(a); if(a > 0 && b == 3) return cbrt(a); return pow(a, 1 / b); }\n"
+			"double powerConstant(double n, int kind, int integerExponent, double exponent, uchar zeroStatus, uchar negativeStatus, uchar* status) { uchar failure = (n == 0 ? zeroStatus : 0) | (n < 0 ? negativeStatus : 0); *status |= failure; if(failure != 0) return NAN;"
+			" if(kind == %d) return signedIntegerPower(n, integerExponent); if(kind == %d) return n > 0 ? sqrt(n) : pow(n, exponent); if(kind == %d) return n > 0 ? cbrt(n) : pow(n, exponent); return pow(n, exponent); }\n",
+			STATUS_DIVIDE_BY_ZERO, STATUS_ZERO_TO_POWER_OF_ZERO, STATUS_NEGATIVE_ROOT_OF_NEGATIVE, STATUS_FRACTIONAL_ROOT_OF_NEGATIVE,
+			PowerPlan::KIND_INTEGER, PowerPlan::KIND_SQUARE_ROOT, PowerPlan::KIND_CUBE_ROOT);
+		return text;
+	}
+
+public:
+	// Returns an empty string for tapes the device cannot run.
+	static string translate(const CompiledExpression& expression)
+	{
+		string source = helpers() + "__kernel void evaluate(";
+		for(size_t i = 0; i < expression.variables.size(); i++)
+		{
+			source += "__global const double* v" + to_string(i) + ", ";
+		}
+		source += "__global double* results, __global uchar* statuses, ulong n)\n{\n\tsize_t row = get_global_id(0);\n\tif(row >= n) return;\n\tuchar status = 0;\n";
+		vector<string> stack;
+		vector<string> saved(MAX_SAVED_VALUES);
+		size_t temporaries = 0;
+		for(const Instruction& instruction : expression.instructions)
+		{
+			string value;
+			size_t operands = 2;
+			const string* a = stack.size() >= 2 ? &stack[stack.size() - 2] : nullptr;
+			const string* b = stack.size() >= 1 ? &stack[stack.size() - 1] : nullptr;
+			switch(instruction.opcode)
+			{
+			case OPCODE_LOAD_CONSTANT:
+				stack.push_back(literal(expression.constants[instruction.operand]));
+				continue;
+			case OPCODE_LOAD_VARIABLE:
+				stack.push_back("v" + to_string(instruction.operand) + "[row]");
+				continue;
+			case OPCODE_LOAD_SAVED:
+				stack.push_back(saved[instruction.operand]);
+				continue;
+			case OPCODE_STORE:
+				saved[instruction.operand] = stack.back();
+				continue;
+			case OPCODE_ADD:
+				value = *a + " + " + *b;
+				break;
+			case OPCODE_SUBTRACT:
+				value = *a + " - " + *b;
+				break;
+			case OPCODE_MULTIPLY:
+				value = *a + " * " + *b;
+				break;
+			case OPCODE_DIVIDE:
+				value = "divideNumbers(" + *a + ", " + *b + ", &status)";
+				break;
+			case OPCODE_POWER:
+				value = "powerNumbers(" + *a + ", " + *b + ", &status)";
+				break;
+			case OPCODE_ROOT:
+				value = "rootNumbers(" + *a + ", " + *b + ", &status)";
+				break;
+			case OPCODE_POWER_CONSTANT:
+			{
+				const PowerPlan& plan = expression.powers[instruction.operand];
+				value = "powerConstant(" + *b + ", " + to_string(plan.kind) + ", " + to_string(plan.integerExponent) + ", " + literal(plan.exponent) + ", " + to_string(plan.zeroBaseStatus) + ", " + to_string(plan.negativeBaseStatus) + ", &status)";
+				operands = 1;
+				break;
+			}
+			case OPCODE_MULTIPLY_ADD:
+			case OPCODE_MULTIPLY_SUBTRACT:
+			case OPCODE_ADD_MULTIPLY:
+			case OPCODE_SUBTRACT_MULTIPLY:
+			{
+				const string& x = stack[stack.size() - 3];
+				if(instruction.opcode == OPCODE_MULTIPLY_ADD) value = "fma(" + x + ", " + *a + ", " + *b + ")";
+				else if(instruction.opcode == OPCODE_MULTIPLY_SUBTRACT) value = "fma(" + x + ", " + *a + ", -" + *b + ")";
+				else if(instruction.opcode == OPCODE_ADD_MULTIPLY) value = "fma(" + *a + ", " + *b + ", " + x + ")";
+				else value = "fma(-" + *a + ", " + *b + ", " + x + ")";
+				operands = 3;
+				break;
+			}
+			default:
+				return string();
+			}
+			string name = "t" + to_string(temporaries++);
+			source += "\tdouble " + name + " = " + value + ";\n";
+			stack.resize(stack.size() - operands);
+			stack.push_back(name);
+		}
+		if(stack.size() != 1) return string();
+		source += "\tresults[row] = " + stack[0] + ";\n\tstatuses[row] = status;\n}\n";
+		return source;
+	}
+
+	OpenClProgram(OpenClDevice& api, const CompiledExpression& expression): api(api), program(nullptr), kernel(nullptr), numberOfVariables(expression.variables.size())
+	{
+		string source = translate(expression);
+		if(source.empty()) return;
+		const char* text = source.c_str();
+		size_t length = source.size();
+		OpenClDevice::Status status;
+		OpenClDevice::Device device = api.getDevice();
+		program = api.createProgramWithSource(api.getContext(), 1, &text, &length, &status);
+		if(status != OpenClDevice::SUCCESS) program = nullptr;
+		if(program == nullptr) return;
+		if(api.buildProgram(program, 1, &device, "", nullptr, nullptr) != OpenClDevice::SUCCESS) return;
+		kernel = api.createKernel(program, "evaluate", &status);
+		if(status != OpenClDevice::SUCCESS) kernel = nullptr;
+	}
+
+	OpenClProgram(const OpenClProgram&) = delete;
+	OpenClProgram& operator=(const OpenClProgram&) = delete;
+
+	~OpenClProgram()
+	{
+		if(kernel != nullptr) api.releaseKernel(kernel);
+		if(program != nullptr) api.releaseProgram(program);
+	}
+
+	bool isBuilt() const
+	{
+		return kernel != nullptr;
+	}
+
+	OpenClDevice::Kernel getKernel() const
+	{
+		return kernel;
+	}
+
+	size_t getNumberOfVariables() const
+	{
+		return numberOfVariables;
+	}
+};
+
+// Runs row groups through the device two at a time: while one group's
+// kernel and transfers are in flight on its queue, the host reads the next
+// group into the other slot's staging buffers and writes out the group
+// before it. Results are handed back in submission order.
+class OpenClPipeline
+{
+public:
+	typedef function<void(const double* results, const unsigned char* statuses, size_t rows)> Consumer;
+
+protected:
+	struct Slot
+	{
+		OpenClDevice::Queue queue;
+		vector<OpenClDevice::Memory> inputs;
+		OpenClDevice::Memory results;
+		OpenClDevice::Memory statuses;
+		size_t capacity;
+		vector<double> staging;
+		vector<double> hostResults;
+		vector<unsigned char> hostStatuses;
+		OpenClDevice::Event done;
+		size_t rows;
+	};
+
+	OpenClDevice& api;
+	OpenClProgram program;
+	Slot slots[2];
+	size_t next;
+	bool failed;
+
+	void releaseBuffers(Slot& slot)
+	{
+		for(OpenClDevice::Memory memory : slot.inputs)
+		{
+			if(memory != nullptr) api.releaseMemObject(memory);
+		}
+		if(slot.results != nullptr) api.releaseMemObject(slot.results);
+		if(slot.statuses != nullptr) api.releaseMemObject(slot.statuses);
+		slot.inputs.assign(slot.inputs.size(), nullptr);
+		slot.results = nullptr;
+		slot.statuses = nullptr;
+		slot.capacity = 0;
+	}
+
+	OpenClDevice::Memory buffer(uint64_t flags, size_t size)
+	{
+		OpenClDevice::Status status;
+		OpenClDevice::Memory memory = api.createBuffer(api.getContext(), flags, size, nullptr, &status);
+		return status == OpenClDevice::SUCCESS ? memory : nullptr;
+	}
+
+	void reserve(Slot& slot, size_t rows)
+	{
+		if(rows <= slot.capacity) return;
+		releaseBuffers(slot);
+		for(OpenClDevice::Memory& memory : slot.inputs)
+		{
+			memory = buffer(OpenClDevice::MEMORY_READ_ONLY, rows * sizeof(double));
+			if(memory == nullptr) throwException("Cannot allocate OpenCL buffers!");
+		}
+		slot.results = buffer(OpenClDevice::MEMORY_WRITE_ONLY, rows * sizeof(double));
+		slot.statuses = buffer(OpenClDevice::MEMORY_WRITE_ONLY, rows);
+		if(slot.results == nullptr || slot.statuses == nullptr) throwException("Cannot allocate OpenCL buffers!");
+		slot.capacity = rows;
+		slot.staging.resize(rows * slot.inputs.size());
+		slot.hostResults.resize(rows);
+		slot.hostStatuses.resize(rows);
+	}
+
+	void complete(Slot& slot, const Consumer& consumer)
+	{
+		if(slot.done == nullptr) return;
+		OpenClDevice::Status status = api.waitForEvents(1, &slot.done);
+		api.releaseEvent(slot.done);
+		slot.done = nullptr;
+		if(status != OpenClDevice::SUCCESS) throwException("OpenCL evaluation failed!");
+		consumer(slot.hostResults.data(), slot.hostStatuses.data(), slot.rows);
+	}
+
+	void check(OpenClDevice::Status status)
+	{
+		if(status != OpenClDevice::SUCCESS) throwException("OpenCL evaluation failed!");
+	}
+
+public:
+	OpenClPipeline(OpenClDevice& api, const CompiledExpression& expression): api(api), program(api, expression), next(0), failed(false)
+	{
+		for(Slot& slot : slots)
+		{
+			OpenClDevice::Status status;
+			slot.queue = program.isBuilt() ? api.createCommandQueue(api.getContext(), api.getDevice(), 0, &status) : nullptr;
+			if(slot.queue != nullptr && status != OpenClDevice::SUCCESS) slot.queue = nullptr;
+			failed |= slot.queue == nullptr;
+			slot.inputs.assign(program.getNumberOfVariables(), nullptr);
+			slot.results = nullptr;
+			slot.statuses = nullptr;
+			slot.capacity = 0;
+			slot.done = nullptr;
+			slot.rows = 0;
+		}
+	}
+
+	OpenClPipeline(const OpenClPipeline&) = delete;
+	OpenClPipeline& operator=(const OpenClPipeline&) = delete;
+
+	~OpenClPipeline()
+	{
+		for(Slot& slot : slots)
+		{
+			if(slot.queue != nullptr) api.finish(slot.queue);
+			if(slot.done != nullptr) api.releaseEvent(slot.done);
+			releaseBuffers(slot);
+			if(slot.queue != nullptr) api.releaseCommandQueue(slot.queue);
+		}
+	}
+
+	bool isReady() const
+	{
+		return !failed;
+	}
+
+	// Copies the group, so the caller's columns may be reused on return.
+	void submit(const double* const* columns, size_t rows, const Consumer& consumer)
+	{
+		Slot& slot = slots[next];
+		next ^= 1;
+		complete(slot, consumer);
+		reserve(slot, rows);
+		OpenClDevice::Kernel kernel = program.getKernel();
+		for(size_t i = 0; i < slot.inputs.size(); i++)
+		{
+			double* staging = &slot.staging[i * slot.capacity];
+			copy(columns[i], columns[i] + rows, staging);
+			check(api.enqueueWriteBuffer(slot.queue, slot.inputs[i], 0, 0, rows * sizeof(double), staging, 0, nullptr, nullptr));
+			check(api.setKernelArg(kernel, i, sizeof(OpenClDevice::Memory), &slot.inputs[i]));
+		}
+		uint64_t count = rows;
+		uint32_t argument = slot.inputs.size();
+		check(api.setKernelArg(kernel, argument, sizeof(OpenClDevice::Memory), &slot.results));
+		check(api.setKernelArg(kernel, argument + 1, sizeof(OpenClDevice::Memory), &slot.statuses));
+		check(api.setKernelArg(kernel, argument + 2, sizeof(count), &count));
+		size_t globalSize = (rows + OPENCL_WORK_GROUP_SIZE - 1) / OPENCL_WORK_GROUP_SIZE * OPENCL_WORK_GROUP_SIZE;
+		check(api.enqueueNDRangeKernel(slot.queue, kernel, 1, nullptr, &globalSize, nullptr, 0, nullptr, nullptr));
+		check(api.enqueueReadBuffer(slot.queue, slot.results, 0, 0, rows * sizeof(double), slot.hostResults.data(), 0, nullptr, nullptr));
+		check(api.enqueueReadBuffer(slot.queue, slot.statuses, 0, 0, rows, slot.hostStatuses.data(), 0, nullptr, &slot.done));
+		check(api.flush(slot.queue));
+		slot.rows = rows;
+	}
+
+	void drain(const Consumer& consumer)
+	{
+		complete(slots[next], consumer);
+		complete(slots[next ^ 1], consumer);
+	}
+};
+#endif
+
+uint64_t hashBytes(const void* data, size_t size, uint64_t hash = 14695981039346656037ULL)
+{
+	const unsigned char* bytes = (const unsigned char*)data;
+	for(size_t i = 0; i < size; i++)
+	{
+		hash = (hash ^ bytes[i]) * 1099511628211ULL;
+	}
+	return hash;
+}
+
+// An on-disk cache of compiled tapes, keyed by formula text. The file is
+// mapped read-only and entries are found by hash in a sorted index, so a
+// hit decodes one entry and skips parsing and optimization. Every field is
+// written explicitly as a little-endian integer of fixed width and padding
+// is zero, so the same tapes always produce the same file. New tapes are
+// kept in memory until save() writes them, together with the existing
+// entries, to a temporary file that replaces the old one. Each entry
+// carries the fingerprint of the operation set and settings it was
+// compiled under and only applies to those, so tapes for several settings,
+// such as with and without fast math, live side by side in one file. A
+// file with another TAPE_CACHE_VERSION is ignored and overwritten by the
+// next save.
+class TapeCache
+{
+protected:
+	// magic, version, number of entries
+	static constexpr size_t fileHeaderSize = 16;
+	// hash, fingerprint, offset, size, checksum
+	static constexpr size_t indexEntrySize = 40;
+	// formula length, then the counts of instructions, constants, powers,
+	// calls and variables, the stack depth and the number of saved values
+	static constexpr size_t tapeHeaderSize = 32;
+	// opcode, zero, operand
+	static constexpr size_t instructionSize = 4;
+	// kind, zero-base status, negative-base status, zero, integer
+	// exponent, exponent
+	static constexpr size_t powerSize = 16;
+
+	struct IndexEntry
+	{
+		uint64_t hash;
+		uint64_t fingerprint;
+		uint64_t offset;
+		uint64_t size;
+		uint64_t checksum;
+	};
+
+	string path;
+	const char* mapping;
+	size_t mappingSize;
+	size_t numberOfEntries;
+	mutable mutex lock;
+	// Keyed by fingerprint, then formula.
+	map<pair<uint64_t, string>, string> added;
+	ShardedCounter hits;
+	ShardedCounter misses;
+
+	static void putInteger(string& out, uint64_t value, size_t bytes)
+	{
+		for(size_t i = 0; i < bytes; i++)
+		{
+			out.push_back((char)(value >> (8 * i)));
+		}
+	}
+
+	static uint64_t getInteger(const char* data, size_t bytes)
+	{
+		uint64_t value = 0;
+		for(size_t i = 0; i < bytes; i++)
+		{
+			value |= (uint64_t)(unsigned char)data[i] << (8 * i);
+		}
+		return value;
+	}
+
+	static double getDouble(const char* data)
+	{
+		uint64_t bits = getInteger(data, 8);
+		double value;
+		memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+
+	static void pad(string& out)
+	{
+		out.resize((out.size() + 7) & ~(size_t)7, '\0');
+	}
+
+	static void serialize(const string& formula, const CompiledExpression& expression, const OperationArena& operations, string& out)
+	{
+		putInteger(out, formula.size(), 4);
+		putInteger(out, expression.instructions.size(), 4);
+		putInteger(out, expression.constants.size(), 4);
+		putInteger(out, expression.powers.size(), 4);
+		putInteger(out, expression.calls.size(), 4);
+		putInteger(out, expression.variables.size(), 4);
+		putInteger(out, expression.maxStackDepth, 4);
+		putInteger(out, expression.numberOfSavedValues, 4);
+		out.append(formula);
+		pad(out);
+		for(double constant : expression.constants)
+		{
+			putInteger(out, bitsOf(constant), 8);
+		}
+		for(const PowerPlan& power : expression.powers)
+		{
+			putInteger(out, power.kind, 1);
+			putInteger(out, power.zeroBaseStatus, 1);
+			putInteger(out, power.negativeBaseStatus, 1);
+			putInteger(out, 0, 1);
+			putInteger(out, (uint32_t)power.integerExponent, 4);
+			putInteger(out, bitsOf(power.exponent), 8);
+		}
+		for(const Instruction& instruction : expression.instructions)
+		{
+			putInteger(out, instruction.opcode, 1);
+			putInteger(out, 0, 1);
+			putInteger(out, instruction.operand, 2);
+		}
+		for(Operation* call : expression.calls)
+		{
+			uint32_t operation = 0;
+			while(operations[operation] != call) operation++;
+			putInteger(out, operation, 4);
+		}
+		for(const string& variable : expression.variables)
+		{
+			putInteger(out, variable.size(), 4);
+			out.append(variable);
+		}
+		pad(out);
+	}
+
+	// Checks every operand and the stack depth. Together with the checksum
+	// of each entry, a damaged file can only cause misses.
+	static bool isValid(const CompiledExpression& expression)
+	{
+		if(expression.maxStackDepth > MAX_STACK_DEPTH || expression.numberOfSavedValues > MAX_SAVED_VALUES) return false;
+		for(const PowerPlan& power : expression.powers)
+		{
+			if(power.kind > PowerPlan::KIND_GENERAL) return false;
+		}
+		size_t depth = 0;
+		for(const Instruction& instruction : expression.instructions)
+		{
+			size_t limit = 0;
+			switch(instruction.opcode)
+			{
+			case OPCODE_LOAD_CONSTANT: limit = expression.constants.size(); break;
+			case OPCODE_LOAD_VARIABLE: limit = expression.variables.size(); break;
+			case OPCODE_CALL: limit = expression.calls.size(); break;
+			case OPCODE_POWER_CONSTANT: limit = expression.powers.size(); break;
+			case OPCODE_STORE:
+			case OPCODE_LOAD_SAVED: limit = expression.numberOfSavedValues; break;
+			default: if(instruction.opcode > OPCODE_SUBTRACT_MULTIPLY) return false; limit = 1;
+			}
+			if(instruction.operand >= limit) return false;
+			int effect = CompiledExpression::stackEffect(instruction.opcode);
+			if(depth < (size_t)(effect == 1 ? 0 : effect == 0 ? 1 : 1 - effect)) return false;
+			depth += effect;
+			if(depth > expression.maxStackDepth) return false;
+		}
+		return depth == 1;
+	}
+
+	static bool deserialize(const char* begin, const char* end, const string_view& formula, const OperationArena& operations, CompiledExpression& expression)
+	{
+		if((size_t)(end - begin) < tapeHeaderSize) return false;
+		uint64_t formulaLength = getInteger(begin, 4);
+		uint64_t numberOfInstructions = getInteger(begin + 4, 4);
+		uint64_t numberOfConstants = getInteger(begin + 8, 4);
+		uint64_t numberOfPowers = getInteger(begin + 12, 4);
+		uint64_t numberOfCalls = getInteger(begin + 16, 4);
+		uint64_t numberOfVariables = getInteger(begin + 20, 4);
+		const char* cursor = begin + tapeHeaderSize;
+		if(formulaLength != formula.size() || (size_t)(end - cursor) < formulaLength || memcmp(cursor, formula.data(), formula.size()) != 0) return false;
+		cursor = begin + ((tapeHeaderSize + formulaLength + 7) & ~(uint64_t)7);
+		uint64_t arrays = numberOfConstants * 8 + numberOfPowers * powerSize + numberOfInstructions * instructionSize + numberOfCalls * 4;
+		if(cursor > end || (uint64_t)(end - cursor) < arrays) return false;
+		for(uint64_t i = 0; i < numberOfConstants; i++, cursor += 8)
+		{
+			expression.constants.push_back(getDouble(cursor));
+		}
+		for(uint64_t i = 0; i < numberOfPowers; i++, cursor += powerSize)
+		{
+			PowerPlan power(OPCODE_POWER, 1);
+			power.kind = (PowerPlan::Kind)cursor[0];
+			power.zeroBaseStatus = cursor[1];
+			power.negativeBaseStatus = cursor[2];
+			power.integerExponent = (int32_t)getInteger(cursor + 4, 4);
+			power.exponent = getDouble(cursor + 8);
+			expression.powers.push_back(power);
+		}
+		for(uint64_t i = 0; i < numberOfInstructions; i++, cursor += instructionSize)
+		{
+			expression.instructions.push_back({(unsigned char)cursor[0], (unsigned short)getInteger(cursor + 2, 2)});
+		}
+		for(uint64_t i = 0; i < numberOfCalls; i++, cursor += 4)
+		{
+			uint64_t operation = getInteger(cursor, 4);
+			if(operation >= operations.size()) return false;
+			expression.calls.push_back(operations[operation]);
+			expression.kernels.push_back(operations[operation]->getScalarKernel());
+		}
+		for(uint64_t i = 0; i < numberOfVariables; i++)
+		{
+			if((size_t)(end - cursor) < 4) return false;
+			uint64_t length = getInteger(cursor, 4);
+			cursor += 4;
+			if((uint64_t)(end - cursor) < length) return false;
+			expression.variables.push_back(string(cursor, length));
+			cursor += length;
+		}
+		expression.maxStackDepth = getInteger(begin + 24, 4);
+		expression.numberOfSavedValues = getInteger(begin + 28, 4);
+		return isValid(expression);
+	}
+
+	IndexEntry indexEntry(size_t i) const
+	{
+		const char* data = mapping + fileHeaderSize + i * indexEntrySize;
+		return IndexEntry{getInteger(data, 8), getInteger(data + 8, 8), getInteger(data + 16, 8), getInteger(data + 24, 8), getInteger(data + 32, 8)};
+	}
+
+	// Returns the entry's tape when it lies inside the mapping, holds the
+	// given formula and matches its checksum.
+	const char* checkedTape(const IndexEntry& entry, const string_view& formula) const
+	{
+		if(entry.offset % 8 != 0 || entry.offset > mappingSize || entry.size > mappingSize - entry.offset || entry.size < tapeHeaderSize) return nullptr;
+		const char* begin = mapping + entry.offset;
+		uint64_t length = getInteger(begin, 4);
+		if(entry.size < tapeHeaderSize + length) return nullptr;
+		if(formula.data() != nullptr && (length != formula.size() || memcmp(begin + tapeHeaderSize, formula.data(), length) != 0)) return nullptr;
+		return hashBytes(begin, entry.size) == entry.checksum ? begin : nullptr;
+	}
+
+	// The index is sorted by hash, then fingerprint.
+	const char* findEntry(uint64_t hash, uint64_t fingerprint, const string_view& formula, size_t& size) const
+	{
+		size_t low = 0;
+		size_t high = numberOfEntries;
+		while(low < high)
+		{
+			size_t middle = low + (high - low) / 2;
+			IndexEntry entry = indexEntry(middle);
+			if(entry.hash < hash || (entry.hash == hash && entry.fingerprint < fingerprint)) low = middle + 1;
+			else high = middle;
+		}
+		for(size_t i = low; i < numberOfEntries; i++)
+		{
+			IndexEntry entry = indexEntry(i);
+			if(entry.hash != hash || entry.fingerprint != fingerprint) break;
+			const char* tape = checkedTape(entry, formula);
+			if(tape != nullptr)
+			{
+				size = entry.size;
+				return tape;
+			}
+		}
+		return nullptr;
+	}
+
+public:
+	TapeCache(const char* path): path(path), mapping(nullptr), mappingSize(0), numberOfEntries(0)
+	{
+		int descriptor = open(path, O_RDONLY | O_CLOEXEC);
+		if(descriptor < 0) return;
+		struct stat information;
+		if(fstat(descriptor, &information) == 0 && S_ISREG(information.st_mode) && (size_t)information.st_size >= fileHeaderSize)
+		{
+			void* mapped = mmap(nullptr, information.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+			if(mapped != MAP_FAILED)
+			{
+				mapping = (const char*)mapped;
+				mappingSize = information.st_size;
+			}
+		}
+		close(descriptor);
+		if(mapping == nullptr) return;
+		bool valid = memcmp(mapping, TAPE_CACHE_MAGIC, 4) == 0 && getInteger(mapping + 4, 4) == TAPE_CACHE_VERSION;
+		uint64_t entries = getInteger(mapping + 8, 8);
+		if(!valid || entries > (mappingSize - fileHeaderSize) / indexEntrySize) return;
+		numberOfEntries = entries;
+	}
+
+	TapeCache(const TapeCache&) = delete;
+	TapeCache& operator=(const TapeCache&) = delete;
+
+	~TapeCache()
+	{
+		if(mapping != nullptr) munmap((void*)mapping, mappingSize);
+	}
+
+	const string& getPath() const
+	{
+		return path;
+	}
+
+	bool find(const string_view& formula, uint64_t fingerprint, const OperationArena& operations, CompiledExpression& expression)
+	{
+		uint64_t hash = hashBytes(formula.data(), formula.size());
+		size_t size = 0;
+		const char* entry = findEntry(hash, fingerprint, formula, size);
+		string copy;
+		if(entry == nullptr)
+		{
+			lock_guard<mutex> guard(lock);
+			map<pair<uint64_t, string>, string>::const_iterator found = added.find(make_pair(fingerprint, string(formula)));
+			if(found != added.end()) copy = found->second;
+		}
+		if(entry == nullptr && !copy.empty())
+		{
+			entry = copy.data();
+			size = copy.size();
+		}
+		CompiledExpression loaded;
+		if(entry != nullptr && deserialize(entry, entry + size, formula, operations, loaded))
+		{
+			expression = move(loaded);
+			hits.add(1);
+			return true;
+		}
+		misses.add(1);
+		return false;
+	}
+
+	void insert(const string_view& formula, uint64_t fingerprint, const CompiledExpression& expression, const OperationArena& operations)
+	{
+		string tape;
+		serialize(string(formula), expression, operations, tape);
+		lock_guard<mutex> guard(lock);
+		added.emplace(make_pair(fingerprint, string(formula)), move(tape));
+	}
+
+	// Does nothing when no tape was added since the file was opened.
+	void save()
+	{
+		lock_guard<mutex> guard(lock);
+		if(added.empty()) return;
+		// hash, fingerprint, tape
+		vector<tuple<uint64_t, uint64_t, string_view>> tapes;
+		for(size_t i = 0; i < numberOfEntries; i++)
+		{
+			IndexEntry entry = indexEntry(i);
+			const char* tape = checkedTape(entry, string_view());
+			if(tape == nullptr || added.count(make_pair(entry.fingerprint, string(tape + tapeHeaderSize, getInteger(tape, 4)))) != 0) continue;
+			tapes.push_back(make_tuple(entry.hash, entry.fingerprint, string_view(tape, entry.size)));
+		}
+		for(const pair<const pair<uint64_t, string>, string>& tape : added)
+		{
+			const string& formula = tape.first.second;
+			tapes.push_back(make_tuple(hashBytes(formula.data(), formula.size()), tape.first.first, string_view(tape.second)));
+		}
+		sort(tapes.begin(), tapes.end());
+		string file(TAPE_CACHE_MAGIC, 4);
+		putInteger(file, TAPE_CACHE_VERSION, 4);
+		putInteger(file, tapes.size(), 8);
+		uint64_t offset = fileHeaderSize + tapes.size() * indexEntrySize;
+		for(const tuple<uint64_t, uint64_t, string_view>& tape : tapes)
+		{
+			const string_view& bytes = get<2>(tape);
+			putInteger(file, get<0>(tape), 8);
+			putInteger(file, get<1>(tape), 8);
+			putInteger(file, offset, 8);
+			putInteger(file, bytes.size(), 8);
+			putInteger(file, hashBytes(bytes.data(), bytes.size()), 8);
+			offset += bytes.size();
+		}
+		for(const tuple<uint64_t, uint64_t, string_view>& tape : tapes)
+		{
+			file.append(get<2>(tape).data(), get<2>(tape).size());
+		}
+		// A unique name per save, so calculators sharing the path, even in
+		// one process, never write into each other's temporary file.
+		string temporary = path + ".XXXXXX";
+		int descriptor = mkstemp(&temporary[0]);
+		if(descriptor < 0) throwException("Cannot create tape cache file!");
+		// mkstemp creates the file for its owner only.
+		bool written = fchmod(descriptor, 0644) == 0;
+		size_t done = 0;
+		while(written && done < file.size())
+		{
+			ssize_t count = write(descriptor, file.data() + done, file.size() - done);
+			if(count < 0 && errno == EINTR) continue;
+			if(count <= 0) written = false;
+			else done += count;
+		}
+		if(close(descriptor) != 0) written = false;
+		if(!written || rename(temporary.c_str(), path.c_str()) != 0)
+		{
+			unlink(temporary.c_str());
+			throwException(written ? "Cannot replace tape cache file!" : "Cannot write tape cache file!");
+		}
+	}
+
+	unsigned long long getNumberOfHits() const
+	{
+		return hits.get();
+	}
+
+	unsigned long long getNumberOfMisses() const
+	{
+		return misses.get();
+	}
+};
+
+Operation* createOperation(const string& operationSymbol, void* memory)
+{
+	const Operation* prototype = OperationRegistry::global().find(operationSymbol);
+	if(prototype == nullptr) throwException("Invalid operator!");
+	return prototype->cloneInto(memory);
+}
+
+#ifdef CALCULATOR_COROUTINES
+template<typename Executor>
+class EvaluationAwaitable;
+
+template<typename Executor>
+class BatchAwaitable;
+#endif
+
+class Calculator
+{
+protected:
+	char name[MAX_NAME_LENGTH + 1];
+	size_t capacityForOperations;
+	// Parsing and evaluation only touch the packed hot entries; the
+	// Operation objects, with their names and symbols, stay cold except for
+	// plugin calls and listSupportedOperations(). Dispatch tables hold
+	// index + 1 into the hot entries, with 0 for an unused slot.
+	struct HotOperation
+	{
+		unsigned char opcode;
+		unsigned char precedence;
+		bool rightAssociative;
+		unsigned char reserved;
+		unsigned int index;
+	};
+
+	struct alignas(CACHE_LINE_SIZE) HotOperationLine
+	{
+		HotOperation entries[CACHE_LINE_SIZE / sizeof(HotOperation)];
+	};
+
+	OperationArena operations;
+	vector<HotOperationLine> hotOperations;
+	unsigned short dispatchTable[2][DISPATCH_TABLE_SIZE];
+	char dispatchSecondCharacter[DISPATCH_TABLE_SIZE];
+	bool hasUndispatchedOperations;
+	unordered_map<string_view, unsigned short> undispatchedOperations;
+	ResultCache* cache;
+	CalculatorMetrics* metrics;
+	// Shared by copies so tapes compiled but not yet saved stay visible.
+	shared_ptr<TapeCache> tapes;
+	bool fastMath;
+	NumberBackend numbers;
+	static ShardedCounter numberOfSuccessfulCalculations;
+
+	friend class CalculatorBenchmark;
+	friend class FormulaGraph;
+
+	void assertValidity()
+	{
+		if(strlen(name) == 0) throwException("Invalid calculator name!");
+		if(capacityForOperations == 0) throwException("Capacity for operations cannot be zero!");
+	}
+
+	void copyFrom(const char* name, size_t numberOfSupportedOperations, size_t capacityForOperations, Operation* const* operations)
+	{
+		if(name == nullptr) name = "";
+		size_t length = 0;
+		while(name[length] != '\0' && length < MAX_NAME_LENGTH)
+		{
+			this->name[length] = name[length];
+			length++;
+		}
+		this->name[length] = '\0';
+		this->capacityForOperations = capacityForOperations;
+		assertValidity();
+		if(numberOfSupportedOperations > capacityForOperations) throwException("Capacity for operations exceeded!");
+		this->operations.clear();
+		for(size_t i = 0; i < numberOfSupportedOperations; i++)
+		{
+			this->operations.add(*operations[i]);
+		}
+		buildDispatchTable();
+	}
+
+	void copyFrom(const Calculator& other)
+	{
+		delete cache;
+		cache = other.cache != nullptr ? new ResultCache(other.cache->getCapacity()) : nullptr;
+		delete metrics;
+		metrics = other.metrics != nullptr ? new CalculatorMetrics() : nullptr;
+		tapes = other.tapes;
+		fastMath = other.fastMath;
+		numbers = other.numbers;
+		copyFrom(other.name, 0, other.capacityForOperations, nullptr);
+		for(size_t i = 0; i < other.operations.size(); i++)
+		{
+			operations.add(*other.operations[i]);
+		}
+		buildDispatchTable();
+	}
+
+	void buildDispatchTable()
+	{
+		for(size_t i = 0; i < DISPATCH_TABLE_SIZE; i++)
+		{
+			dispatchTable[0][i] = 0;
+			dispatchTable[1][i] = 0;
+			dispatchSecondCharacter[i] = '\0';
+		}
+		hasUndispatchedOperations = false;
+		undispatchedOperations.clear();
+		hotOperations.clear();
+		for(size_t i = 0; i < operations.size(); i++)
+		{
+			addToDispatchTable(i);
+		}
+	}
+
+	HotOperation& hotOperation(size_t index)
+	{
+		return hotOperations[index / (CACHE_LINE_SIZE / sizeof(HotOperation))].entries[index % (CACHE_LINE_SIZE / sizeof(HotOperation))];
+	}
+
+	const HotOperation& hotOperation(size_t index) const
+	{
+		return hotOperations[index / (CACHE_LINE_SIZE / sizeof(HotOperation))].entries[index % (CACHE_LINE_SIZE / sizeof(HotOperation))];
+	}
+
+	// Entries are appended in index order, so index must be the next one.
+	void addToDispatchTable(size_t index)
+	{
+		const Operation* operation = operations[index];
+		if(index >= numeric_limits<unsigned short>::max()) throwException("Capacity for operations exceeded!");
+		if(index % (CACHE_LINE_SIZE / sizeof(HotOperation)) == 0) hotOperations.emplace_back();
+		hotOperation(index) = {(unsigned char)operation->getOpcode(), operation->getPrecedence(), operation->isRightAssociative(), 0, (unsigned int)index};
+		unsigned short entry = index + 1;
+		const string& symbol = operation->getSymbol();
+		unsigned char first = symbol[0];
+		if(symbol.size() == 1)
+		{
+			if(dispatchTable[0][first] == 0) dispatchTable[0][first] = entry;
+		}
+		else if(symbol.size() == 2 && dispatchTable[1][first] == 0)
+		{
+			dispatchTable[1][first] = entry;
+			dispatchSecondCharacter[first] = symbol[1];
+		}
+		else if(symbol.size() != 2 || dispatchSecondCharacter[first] != symbol[1])
+		{
+			hasUndispatchedOperations = true;
+			undispatchedOperations.emplace(string_view(symbol), entry);
+		}
+	}
+
+	const HotOperation* findHotOperation(const char* symbol, size_t length) const
+	{
+		if(length == 0) return nullptr;
+		unsigned char first = symbol[0];
+		if(length == 1 && dispatchTable[0][first] != 0) return &hotOperation(dispatchTable[0][first] - 1);
+		if(length == 2 && dispatchTable[1][first] != 0 && dispatchSecondCharacter[first] == symbol[1]) return &hotOperation(dispatchTable[1][first] - 1);
+		if(!hasUndispatchedOperations) return nullptr;
+		unordered_map<string_view, unsigned short>::const_iterator found = undispatchedOperations.find(string_view(symbol, length));
+		if(found != undispatchedOperations.end()) return &hotOperation(found->second - 1);
+		return nullptr;
+	}
+
+	Operation* findOperation(const char* symbol, size_t length) const
+	{
+		const HotOperation* operation = findHotOperation(symbol, length);
+		return operation != nullptr ? operations[operation->index] : nullptr;
+	}
+
+	template<typename Recorder>
+	struct EvaluationSink
+	{
+		double values[MAX_STACK_DEPTH + 1];
+		size_t top;
+		unsigned char& status;
+		Recorder& recorder;
+		const OperationArena& operations;
+
+		EvaluationSink(unsigned char& status, Recorder& recorder, const OperationArena& operations): top(0), status(status), recorder(recorder), operations(operations) {};
+
+		bool operand(const char* token, const char* end)
+		{
+			const char* parsed;
+			return parseNumber(token, end, values[top], parsed) && parsed == end && ++top;
+		}
+
+		void operation(const HotOperation& operation)
+		{
+			top--;
+			if(operation.opcode == OPCODE_CALL) values[top - 1] = operations[operation.index]->execute(values[top - 1], values[top], status);
+			else values[top - 1] = applyOpcode(operation.opcode, values[top - 1], values[top], status);
+			recorder.operation(operation.opcode);
+		}
+	};
+
+	struct CompilationSink
+	{
+		CompiledExpression& expression;
+		size_t depth;
+		const OperationArena& operations;
+
+		CompilationSink(CompiledExpression& expression, const OperationArena& operations): expression(expression), depth(0), operations(operations) {};
+
+		// Names come before numbers, or "inf" and "nan" would silently read
+		// as constants instead of binding to variables of those names.
+		bool operand(const char* token, const char* end)
+		{
+			double value;
+			const char* parsed;
+			if(isVariableName(token, end - token)) expression.pushVariable(token, end - token, depth);
+			else if(parseNumber(token, end, value, parsed) && parsed == end) expression.pushConstant(value, depth);
+			else return false;
+			return true;
+		}
+
+		void operation(const HotOperation& operation)
+		{
+			expression.pushOperation(operations[operation.index], depth);
+		}
+	};
+
+	// Operations are applied by opcode, so plugin operations, which only
+	// have a double kernel, are rejected by the exact backends.
+	template<typename Number>
+	struct ExactSink
+	{
+		Number values[MAX_STACK_DEPTH + 1];
+		size_t top;
+		unsigned char& status;
+
+		ExactSink(unsigned char& status): top(0), status(status) {};
+
+		bool operand(const char* token, const char* end)
+		{
+			return Number::parse(token, end, values[top], status) && ++top;
+		}
+
+		void operation(const HotOperation& operation)
+		{
+			top--;
+			values[top - 1] = applyExact(operation.opcode, values[top - 1], values[top], status);
+		}
+	};
+
+	template<typename Number>
+	void evaluateExactLine(const char* line, const char* end, string& output, unsigned char& status) const
+	{
+		status = STATUS_OK;
+		ExactSink<Number> sink(status);
+		if(parse(line, end, sink, status) && status == STATUS_OK) sink.values[0].appendTo(output);
+	}
+
+	// The result cache key is the token sequence parse() reads, one blank
+	// between tokens: parentheses stand alone and operators take their
+	// registered symbol. Operands and anything parse() would reject are
+	// kept verbatim, so a rejected line still fails the same way.
+	void cacheKey(const char* text, const char* end, string& key) const
+	{
+		key.clear();
+		bool expectOperand = true;
+		while(true)
+		{
+			while(text < end && isBlank(*text)) text++;
+			if(text == end || *text == '=') break;
+			if(!key.empty()) key.push_back(' ');
+			const char* token = text;
+			while(text < end && !isDelimiter(*text)) text++;
+			if(text == token)
+			{
+				key.push_back(*text++);
+				continue;
+			}
+			const HotOperation* operation = expectOperand ? nullptr : findHotOperation(token, text - token);
+			if(operation != nullptr) key.append(operations[operation->index]->getSymbol());
+			else key.append(token, text - token);
+			expectOperand = !expectOperand;
+		}
+	}
+
+	template<typename Recorder>
+	bool evaluateLine(const char* line, const char* end, double& result, unsigned char& status, Recorder& recorder) const
+	{
+		thread_local string key;
+		if(cache != nullptr)
+		{
+			cacheKey(line, end, key);
+			if(cache->find(key, result, status))
+			{
+				recorder.finish(status);
+				return true;
+			}
+		}
+		status = STATUS_OK;
+		EvaluationSink<Recorder> sink(status, recorder, operations);
+		if(parse(line, end, sink, status)) result = sink.values[0];
+		else result = numeric_limits<double>::quiet_NaN();
+		if(cache != nullptr) cache->insert(key, result, status);
+		recorder.finish(status);
+		return true;
+	}
+
+	static bool bindsBefore(const HotOperation* stacked, const HotOperation* incoming)
+	{
+		if(stacked->precedence != incoming->precedence) return stacked->precedence > incoming->precedence;
+		return !incoming->rightAssociative;
+	}
+
+	template<typename Sink>
+	bool parse(const char* text, const char* end, Sink& sink, unsigned char& status) const
+	{
+		const HotOperation* operators[MAX_STACK_DEPTH];
+		size_t top = 0;
+		bool expectOperand = true;
+		while(true)
+		{
+			while(text < end && isBlank(*text)) text++;
+			if(text == end || *text == '=') break;
+			if(expectOperand)
+			{
+				if(*text == '(')
+				{
+					if(top == MAX_STACK_DEPTH) break;
+					operators[top++] = nullptr;
+					text++;
+					continue;
+				}
+				const char* token = text;
+				while(text < end && !isDelimiter(*text)) text++;
+				if(!sink.operand(token, text)) break;
+				expectOperand = false;
+				continue;
+			}
+			if(*text == ')')
+			{
+				while(top > 0 && operators[top - 1] != nullptr)
+				{
+					sink.operation(*operators[--top]);
+				}
+				if(top == 0) break;
+				top--;
+				text++;
+				continue;
+			}
+			const char* token = text;
+			while(text < end && !isDelimiter(*text)) text++;
+			const HotOperation* operation = findHotOperation(token, text - token);
+			if(operation == nullptr)
+			{
+				status |= STATUS_INVALID_OPERATOR;
+				return false;
+			}
+			while(top > 0 && operators[top - 1] != nullptr && bindsBefore(operators[top - 1], operation))
+			{
+				sink.operation(*operators[--top]);
+			}
+			if(top == MAX_STACK_DEPTH) break;
+			operators[top++] = operation;
+			expectOperand = true;
+		}
+		bool complete = (text == end || *text == '=') && !expectOperand;
+		while(complete && top > 0)
+		{
+			if(operators[top - 1] == nullptr) complete = false;
+			else sink.operation(*operators[--top]);
+		}
+		if(!complete) status |= STATUS_INVALID_EXPRESSION;
+		return complete;
+	}
+
+	double calculate(double n1, double n2, const char* op, size_t length) const
+	{
+		Operation* operation = findOperation(op, length);
+		if(operation == nullptr) return 0;
+		return operation->execute(n1, n2);
+	}
+
+	double calculate(double n1, double n2, const string& op) const
+	{
+		return calculate(n1, n2, op.data(), op.size());
+	}
+
+	double calculate(double n1, double n2, const char* op, size_t length, unsigned char& status) const
+	{
+		Operation* operation = findOperation(op, length);
+		if(operation == nullptr)
+		{
+			status |= STATUS_INVALID_OPERATOR;
+			return numeric_limits<double>::quiet_NaN();
+		}
+		return operation->execute(n1, n2, status);
+	}
+
+public:
+	Calculator(): cache(nullptr), metrics(nullptr), fastMath(false), numbers(NUMBERS_DOUBLE)
+	{
+		copyFrom("Calculator", 0, 2, nullptr);
+	}
+
+	Calculator(const char* name): cache(nullptr), metrics(nullptr), fastMath(false), numbers(NUMBERS_DOUBLE)
+	{
+		copyFrom(name, 0, numeric_limits<size_t>::max(), nullptr);
+	}
+
+	Calculator(const char* name, size_t n, Operation* const* ops): cache(nullptr), metrics(nullptr), fastMath(false), numbers(NUMBERS_DOUBLE)
+	{
+		copyFrom(name, n, numeric_limits<size_t>::max(), ops);
+	}
+
+	Calculator(const Calculator& other): cache(nullptr), metrics(nullptr), fastMath(false), numbers(NUMBERS_DOUBLE)
+	{
+		copyFrom(other);
+	}
+
+	const Calculator& operator=(const Calculator& other)
+	{
+		if(this != &other)
+		{
+			copyFrom(other);
+		}
+		return *this;
+	}
+
+	~Calculator()
+	{
+		delete cache;
+		delete metrics;
+	}
+
+	void enableCache(size_t capacity)
+	{
+		delete cache;
+		cache = capacity != 0 ? new ResultCache(capacity) : nullptr;
+	}
+
+	void enableTapeCache(const char* path)
+	{
+		tapes = path != nullptr ? make_shared<TapeCache>(path) : nullptr;
+	}
+
+	void saveTapeCache()
+	{
+		if(tapes != nullptr) tapes->save();
+	}
+
+	const TapeCache* getTapeCache() const
+	{
+		return tapes.get();
+	}
+
+	// Covers everything a compiled tape depends on: the operation set and
+	// fast math.
+	uint64_t getTapeFingerprint() const
+	{
+		unsigned char settings = fastMath;
+		uint64_t hash = hashBytes(&settings, sizeof(settings));
+		for(size_t i = 0; i < operations.size(); i++)
+		{
+			const string& symbol = operations[i]->getSymbol();
+			unsigned char traits[] = {(unsigned char)operations[i]->getOpcode(), operations[i]->getPrecedence(), operations[i]->isRightAssociative()};
+			hash = hashBytes(symbol.c_str(), symbol.size() + 1, hash);
+			hash = hashBytes(traits, sizeof(traits), hash);
+		}
+		return hash;
+	}
+
+	void enableMetrics(bool enabled = true)
+	{
+		delete metrics;
+		metrics = enabled ? new CalculatorMetrics() : nullptr;
+	}
+
+	void setFastMath(bool enabled)
+	{
+		fastMath = enabled;
+	}
+
+	void setNumberBackend(NumberBackend backend)
+	{
+		numbers = backend;
+	}
+
+	NumberBackend getNumberBackend() const
+	{
+		return numbers;
+	}
+
+	const CalculatorMetrics* getMetrics() const
+	{
+		return metrics;
+	}
+
+	void listSupportedOperations() const
+	{
+		for(size_t i = 0; i < operations.size(); i++)
+		{
+			cout << operations[i]->getSymbol() << " - " << operations[i]->getName() << endl;
+		}
+	}
+
+	void listInputFormat() const
+	{
+		cout << "<num1> <symbol> <num2> <symbol> <num3> ... <numN> =" << endl;
+		cout << "Please make sure to include spaces between each number and operator." << endl;
+		cout << "** and V are evaluated first (right to left), then * and /, then + and -." << endl;
+		cout << "Use ( and ) to group parts of the expression." << endl;
+	}
+
+	Calculator& addOperation(const Operation* op)
+	{
+		if(operations.size() == capacityForOperations) throwException("Capacity for operations exceeded!");
+		operations.add(*op);
+		addToDispatchTable(operations.size() - 1);
+		return *this;
+	}
+
+	Calculator& addOperation(const string& symbol)
+	{
+		if(operations.size() == capacityForOperations) throwException("Capacity for operations exceeded!");
+		operations.add(createOperation(symbol, operations.allocate()));
+		addToDispatchTable(operations.size() - 1);
+		return *this;
+	}
+
+	Calculator& addOperations(const OperationRegistry& registry)
+	{
+		for(size_t i = 0; i < registry.size(); i++)
+		{
+			addOperation(&registry[i]);
+		}
+		return *this;
+	}
+
+	double evaluate(istream& in) const
+	{
+		string expression;
+		string token;
+		while(in >> token && token != "=")
+		{
+			expression += token;
+			expression += ' ';
+		}
+		double result;
+		unsigned char status;
+		if(!evaluateLine(expression.data(), expression.data() + expression.size(), result, status)) status = STATUS_INVALID_EXPRESSION;
+		assertSuccess(status);
+		return result;
+	}
+
+	bool evaluateLine(const char* line, const char* end, double& result, unsigned char& status) const
+	{
+		while(line < end && isBlank(*line)) line++;
+		if(line == end) return false;
+		if(metrics == nullptr)
+		{
+			CalculatorMetrics::NullRecorder recorder;
+			return evaluateLine(line, end, result, status, recorder);
+		}
+		CalculatorMetrics::Recorder recorder(metrics->local());
+		return evaluateLine(line, end, result, status, recorder);
+	}
+
+	bool evaluateLine(const char* line, const char* end, string& output, unsigned char& status) const
+	{
+		while(line < end && isBlank(*line)) line++;
+		if(line == end) return false;
+		switch(numbers)
+		{
+			case NUMBERS_FIXED_POINT: evaluateExactLine<FixedPoint<FIXED_POINT_DECIMALS>>(line, end, output, status); return true;
+			case NUMBERS_DECIMAL128: evaluateExactLine<Decimal128>(line, end, output, status); return true;
+			case NUMBERS_BIG_DECIMAL: evaluateExactLine<BigDecimal>(line, end, output, status); return true;
+			case NUMBERS_DOUBLE: break;
+		}
+		double result;
+		evaluateLine(line, end, result, status);
+		if(status == STATUS_OK) appendNumber(output, result);
+		return true;
+	}
+
+	// With an aggregate, successful results are folded into it instead of
+	// being written; exact results are handed over as printed, so that it
+	// can keep them in the backend's own type.
+	size_t evaluateChunk(const char* begin, const char* end, string& output, FailureSummary& failures, ResultAggregate* aggregate = nullptr) const
+	{
+		if(aggregate != nullptr && aggregate->getNumberBackend() != numbers) throwException("Aggregate does not match the number backend!");
+		size_t evaluated = 0;
+		while(begin < end)
+		{
+			const char* lineEnd = find(begin, end, '\n');
+			double result;
+			unsigned char status;
+			bool exact = numbers != NUMBERS_DOUBLE;
+			size_t mark = output.size();
+			if(exact ? evaluateLine(begin, lineEnd, output, status) : evaluateLine(begin, lineEnd, result, status))
+			{
+				if(status == STATUS_OK && aggregate != nullptr)
+				{
+					if(exact) aggregate->record(output.data() + mark, output.data() + output.size());
+					else aggregate->record(result);
+					output.resize(mark);
+					evaluated++;
+				}
+				else if(status == STATUS_OK)
+				{
+					if(!exact) appendNumber(output, result);
+					output.push_back('\n');
+					evaluated++;
+				}
+				else if(aggregate != nullptr) failures.record(status);
+				else
+				{
+					output.append("error: ");
+					output.append(describeStatus(status));
+					output.push_back('\n');
+					failures.record(status);
+				}
+			}
+			begin = lineEnd + 1;
+		}
+		numberOfSuccessfulCalculations.add(evaluated);
+		return evaluated;
+	}
+
+	void startCalculation() const
+	{
+		double result = evaluate(cin);
+		numberOfSuccessfulCalculations.add(1);
+		cout << result << endl;
+	}
+
+	FailureSummary runBatch(istream& in, ostream& out, ResultAggregate* aggregate = nullptr) const
+	{
+		FailureSummary failures;
+		string line;
+		string buffer;
+		buffer.reserve(BATCH_OUTPUT_BUFFER_SIZE + 256);
+		while(getline(in, line))
+		{
+			evaluateChunk(line.data(), line.data() + line.size(), buffer, failures, aggregate);
+			if(buffer.size() >= BATCH_OUTPUT_BUFFER_SIZE)
+			{
+				out.write(buffer.data(), buffer.size());
+				buffer.clear();
+			}
+		}
+		out.write(buffer.data(), buffer.size());
+		out.flush();
+		return failures;
+	}
+
+	// Each chunk aggregates into its own partial and partials are merged in
+	// input order, so the aggregate does not depend on the number of threads.
+	FailureSummary runBatch(BatchInput& input, ostream& out, ResultAggregate* aggregate = nullptr) const
+	{
+		FailureSummary failures;
+		vector<const char*> chunkStarts;
+		string buffer;
+		const char* begin;
+		const char* end;
+		while(input.nextBlock(begin, end))
+		{
+			BatchInput::sliceLines(begin, end, BATCH_CHUNK_SIZE, chunkStarts);
+			for(size_t i = 0; i + 1 < chunkStarts.size(); i++)
+			{
+				buffer.clear();
+				ResultAggregate partial(numbers);
+				evaluateChunk(chunkStarts[i], chunkStarts[i + 1], buffer, failures, aggregate != nullptr ? &partial : nullptr);
+				if(aggregate != nullptr) aggregate->merge(partial);
+				out.write(buffer.data(), buffer.size());
+			}
+		}
+		out.flush();
+		return failures;
+	}
+
+	FailureSummary runParallelBatch(BatchInput& input, ostream& out, ThreadPool& pool, ResultAggregate* aggregate = nullptr) const
+	{
+		FailureSummary failures;
+		vector<const char*> chunkStarts;
+		vector<string> outputs;
+		vector<FailureSummary> chunkFailures;
+		vector<ResultAggregate> partials;
+		const char* begin;
+		const char* end;
+		while(input.nextBlock(begin, end))
+		{
+			BatchInput::sliceLines(begin, end, BATCH_CHUNK_SIZE, chunkStarts);
+			size_t numberOfChunks = chunkStarts.size() - 1;
+			if(outputs.size() < numberOfChunks) outputs.resize(numberOfChunks);
+			chunkFailures.assign(numberOfChunks, FailureSummary());
+			if(aggregate != nullptr) partials.assign(numberOfChunks, ResultAggregate(numbers));
+			pool.run(numberOfChunks, [&](size_t i)
+			{
+				outputs[i].clear();
+				evaluateChunk(chunkStarts[i], chunkStarts[i + 1], outputs[i], chunkFailures[i], aggregate != nullptr ? &partials[i] : nullptr);
+			});
+			for(size_t i = 0; i < numberOfChunks; i++)
+			{
+				out.write(outputs[i].data(), outputs[i].size());
+				failures.merge(chunkFailures[i]);
+				if(aggregate != nullptr) aggregate->merge(partials[i]);
+			}
+		}
+		out.flush();
+		return failures;
+	}
+
+	// With COLUMN_DEVICE_AUTO, groups of at least OPENCL_MIN_ROWS go to an
+	// OpenCL device when one is present and the tape has no plugin calls;
+	// COLUMN_DEVICE_OPENCL sends every group there or fails.
+	FailureSummary runColumnarBatch(const CompiledExpression& expression, ColumnarReader& input, ColumnarWriter& output, ThreadPool* pool = nullptr, ColumnDevice device = COLUMN_DEVICE_CPU) const
+	{
+		vector<int> sources(expression.getNumberOfVariables());
+		for(size_t i = 0; i < sources.size(); i++)
+		{
+			sources[i] = input.findColumn(expression.getVariableName(i));
+			if(sources[i] < 0) throwException("Columnar input has no column for a variable!");
+		}
+		size_t numberOfTasks = pool != nullptr ? pool->getNumberOfThreads() : 1;
+		vector<FailureSummary> failures(numberOfTasks);
+		vector<const double*> columns;
+		vector<const double*> variables(sources.size());
+		vector<double> results;
+		vector<unsigned char> statuses;
+		size_t rows;
+#ifdef CALCULATOR_OPENCL
+		unique_ptr<OpenClPipeline> offload;
+		OpenClDevice* api = device != COLUMN_DEVICE_CPU ? OpenClDevice::get() : nullptr;
+		if(api != nullptr) offload.reset(new OpenClPipeline(*api, expression));
+		if(offload != nullptr && !offload->isReady()) offload.reset();
+		OpenClPipeline::Consumer consumer = [&](const double* result, const unsigned char* status, size_t count)
+		{
+			for(size_t i = 0; i < count; i++)
+			{
+				if(status[i] != STATUS_OK) failures[0].record(status[i]);
+			}
+			output.writeGroup(&result, count);
+		};
+		bool offloading = offload != nullptr;
+#else
+		bool offloading = false;
+#endif
+		if(device == COLUMN_DEVICE_OPENCL && !offloading) throwException("No OpenCL device can evaluate this formula!");
+		while(input.nextGroup(columns, rows))
+		{
+			for(size_t i = 0; i < sources.size(); i++)
+			{
+				variables[i] = columns[sources[i]];
+			}
+#ifdef CALCULATOR_OPENCL
+			if(offload != nullptr && (device == COLUMN_DEVICE_OPENCL || rows >= OPENCL_MIN_ROWS))
+			{
+				offload->submit(variables.data(), rows, consumer);
+				continue;
+			}
+			if(offload != nullptr) offload->drain(consumer);
+#endif
+			results.resize(rows);
+			statuses.resize(rows);
+			size_t slice = (rows / numberOfTasks + COLUMN_BLOCK_SIZE - 1) / COLUMN_BLOCK_SIZE * COLUMN_BLOCK_SIZE;
+			function<void(size_t)> task = [&](size_t index)
+			{
+				size_t begin = index * slice;
+				size_t end = index + 1 == numberOfTasks ? rows : min(rows, begin + slice);
+				if(begin >= end) return;
+				vector<const double*> offsetVariables(variables.size());
+				for(size_t i = 0; i < variables.size(); i++)
+				{
+					offsetVariables[i] = variables[i] + begin;
+				}
+				evaluateColumns(expression, offsetVariables.data(), results.data() + begin, statuses.data() + begin, end - begin);
+				for(size_t i = begin; i < end; i++)
+				{
+					if(statuses[i] != STATUS_OK) failures[index].record(statuses[i]);
+				}
+			};
+			if(pool != nullptr) pool->run(numberOfTasks, task);
+			else task(0);
+			const double* result = results.data();
+			output.writeGroup(&result, rows);
+		}
+#ifdef CALCULATOR_OPENCL
+		if(offload != nullptr) offload->drain(consumer);
+#endif
+		output.finish();
+		for(size_t i = 1; i < numberOfTasks; i++)
+		{
+			failures[0].merge(failures[i]);
+		}
+		return failures[0];
+	}
+
+	CompiledExpression compile(const char* begin, const char* end) const
+	{
+		CompiledExpression expression;
+		string_view formula(begin, end - begin);
+		uint64_t fingerprint = 0;
+		if(tapes != nullptr)
+		{
+			fingerprint = getTapeFingerprint();
+			if(tapes->find(formula, fingerprint, operations, expression)) return expression;
+		}
+		CompilationSink sink(expression, operations);
+		unsigned char status = STATUS_OK;
+		parse(begin, end, sink, status);
+		assertSuccess(status);
+		expression.optimize(fastMath);
+		if(tapes != nullptr) tapes->insert(formula, fingerprint, expression, operations);
+		return expression;
+	}
+
+	CompiledExpression compile(const char* text) const
+	{
+		return compile(text, text + strlen(text));
+	}
+
+	CompiledExpression compile(const string& text) const
+	{
+		return compile(text.data(), text.data() + text.size());
+	}
+
+	void evaluateColumns(const CompiledExpression& expression, const double* const* columns, double* results, size_t n) const
+	{
+		expression.evaluateColumns(columns, results, n);
+		numberOfSuccessfulCalculations.add(n);
+	}
+
+	void evaluateColumns(const CompiledExpression& expression, const double* const* columns, double* results, unsigned char* statuses, size_t n) const
+	{
+		expression.evaluateColumns(columns, results, statuses, n);
+		numberOfSuccessfulCalculations.add(count(statuses, statuses + n, STATUS_OK));
+	}
+
+	void evaluate(const ExpressionBinding& binding, double* results, unsigned char* statuses, size_t n) const
+	{
+		binding.evaluate(results, statuses, n);
+		numberOfSuccessfulCalculations.add(count(statuses, statuses + n, STATUS_OK));
+	}
+
+#ifdef CALCULATOR_COROUTINES
+	template<typename Executor>
+	EvaluationAwaitable<Executor> evaluate(string expression, Executor& executor) const
+	{
+		return EvaluationAwaitable<Executor>(*this, move(expression), executor);
+	}
+
+	template<typename Executor>
+	BatchAwaitable<Executor> evaluateBatch(string input, Executor& executor) const
+	{
+		return BatchAwaitable<Executor>(*this, move(input), executor);
+	}
+#endif
+
+	double getNumberOfSuccessfulCalculations() const
+	{
+		return numberOfSuccessfulCalculations.get();
+	}
+
+	double getNumberOfCacheHits() const
+	{
+		return cache != nullptr ? cache->getNumberOfHits() : 0;
+	}
+
+	double getNumberOfCacheMisses() const
+	{
+		return cache != nullptr ? cache->getNumberOfMisses() : 0;
+	}
+};
+
+ShardedCounter Calculator::numberOfSuccessfulCalculations;
+
+Operation* createOperation(string operationSymbol)
+{
+	const Operation* prototype = OperationRegistry::global().find(operationSymbol);
+	if(prototype == nullptr) throwException("Invalid operator!");
+	return prototype->createNew();
+}
+
+class FormulaGraph
+{
+protected:
+	struct Node
+	{
+		string name;
+		bool isInput;
+		bool dirty;
+		bool changed;
+		unsigned char status;
+		size_t level;
+		double value;
+		CompiledExpression expression;
+		vector<size_t> arguments;
+		vector<size_t> dependents;
+	};
+
+	const Calculator& calculator;
+	vector<Node> nodes;
+	unordered_map<string, size_t> indices;
+	vector<vector<size_t>> dirtyByLevel;
+	size_t numberOfDirtyNodes;
+	bool structureChanged;
+
+	size_t findOrCreate(const string& name)
+	{
+		unordered_map<string, size_t>::const_iterator found = indices.find(name);
+		if(found != indices.end()) return found->second;
+		Node node;
+		node.name = name;
+		node.isInput = true;
+		node.dirty = false;
+		node.changed = false;
+		node.status = STATUS_INVALID_EXPRESSION;
+		node.level = 0;
+		node.value = numeric_limits<double>::quiet_NaN();
+		nodes.push_back(move(node));
+		indices.emplace(name, nodes.size() - 1);
+		return nodes.size() - 1;
+	}
+
+	void detach(size_t index)
+	{
+		for(size_t argument : nodes[index].arguments)
+		{
+			vector<size_t>& dependents = nodes[argument].dependents;
+			dependents.erase(find(dependents.begin(), dependents.end(), index));
+		}
+		nodes[index].arguments.clear();
+	}
+
+	bool dependsOn(size_t from, size_t target) const
+	{
+		vector<bool> visited(nodes.size(), false);
+		vector<size_t> stack(1, from);
+		while(!stack.empty())
+		{
+			size_t index = stack.back();
+			stack.pop_back();
+			if(index == target) return true;
+			if(visited[index]) continue;
+			visited[index] = true;
+			stack.insert(stack.end(), nodes[index].arguments.begin(), nodes[index].arguments.end());
+		}
+		return false;
+	}
+
+	void markDirty(size_t index)
+	{
+		Node& node = nodes[index];
+		if(node.dirty) return;
+		node.dirty = true;
+		numberOfDirtyNodes++;
+		if(!structureChanged) dirtyByLevel[node.level].push_back(index);
+	}
+
+	void markDependentsDirty(size_t index)
+	{
+		for(size_t dependent : nodes[index].dependents)
+		{
+			markDirty(dependent);
+		}
+	}
+
+	void rebuildLevels()
+	{
+		vector<size_t> remaining(nodes.size());
+		vector<size_t> ready;
+		size_t deepest = 0;
+		for(size_t i = 0; i < nodes.size(); i++)
+		{
+			nodes[i].level = nodes[i].isInput ? 0 : 1;
+			remaining[i] = nodes[i].arguments.size();
+			if(remaining[i] == 0) ready.push_back(i);
+		}
+		while(!ready.empty())
+		{
+			size_t index = ready.back();
+			ready.pop_back();
+			deepest = max(deepest, nodes[index].level);
+			for(size_t dependent : nodes[index].dependents)
+			{
+				nodes[dependent].level = max(nodes[dependent].level, nodes[index].level + 1);
+				if(--remaining[dependent] == 0) ready.push_back(dependent);
+			}
+		}
+		dirtyByLevel.assign(deepest + 1, vector<size_t>());
+		for(size_t i = 0; i < nodes.size(); i++)
+		{
+			if(nodes[i].dirty) dirtyByLevel[nodes[i].level].push_back(i);
+		}
+		structureChanged = false;
+	}
+
+	void evaluateNode(size_t index)
+	{
+		thread_local vector<double> values;
+		Node& node = nodes[index];
+		values.resize(node.arguments.size());
+		unsigned char status = STATUS_OK;
+		for(size_t i = 0; i < node.arguments.size(); i++)
+		{
+			const Node& argument = nodes[node.arguments[i]];
+			values[i] = argument.value;
+			status |= argument.status;
+		}
+		double value = status == STATUS_OK ? node.expression.evaluate(values.data(), status) : numeric_limits<double>::quiet_NaN();
+		node.changed = bitsOf(value) != bitsOf(node.value) || status != node.status;
+		node.value = value;
+		node.status = status;
+	}
+
+	size_t index(const string& name) const
+	{
+		unordered_map<string, size_t>::const_iterator found = indices.find(name);
+		if(found == indices.end()) throwException("Formula graph has no such node!");
+		return found->second;
+	}
+
+public:
+	FormulaGraph(const Calculator& calculator): calculator(calculator), dirtyByLevel(1), numberOfDirtyNodes(0), structureChanged(false) {};
+
+	void setInput(const string& name, double value)
+	{
+		size_t index = findOrCreate(name);
+		Node& node = nodes[index];
+		if(!node.isInput)
+		{
+			detach(index);
+			node.isInput = true;
+			node.expression = CompiledExpression();
+			if(node.dirty) numberOfDirtyNodes--;
+			node.dirty = false;
+			structureChanged = true;
+		}
+		else if(node.status == STATUS_OK && bitsOf(node.value) == bitsOf(value)) return;
+		node.value = value;
+		node.status = STATUS_OK;
+		markDependentsDirty(index);
+	}
+
+	void define(const string& name, const string& formula)
+	{
+		CompiledExpression expression = calculator.compile(formula);
+		size_t index = findOrCreate(name);
+		vector<size_t> arguments(expression.getNumberOfVariables());
+		for(size_t i = 0; i < arguments.size(); i++)
+		{
+			arguments[i] = findOrCreate(expression.getVariableName(i));
+			if(dependsOn(arguments[i], index)) throwException("Formula depends on itself!");
+		}
+		detach(index);
+		Node& node = nodes[index];
+		node.isInput = false;
+		node.expression = move(expression);
+		node.arguments = move(arguments);
+		for(size_t argument : node.arguments)
+		{
+			nodes[argument].dependents.push_back(index);
+		}
+		structureChanged = true;
+		markDirty(index);
+	}
+
+	size_t recalculate(ThreadPool* pool = nullptr)
+	{
+		if(structureChanged) rebuildLevels();
+		size_t evaluated = 0;
+		size_t successful = 0;
+		for(size_t level = 1; level < dirtyByLevel.size(); level++)
+		{
+			vector<size_t>& dirty = dirtyByLevel[level];
+			if(dirty.empty()) continue;
+			if(pool != nullptr && dirty.size() >= FORMULA_GRAPH_PARALLEL_NODES)
+			{
+				pool->run((dirty.size() + FORMULA_GRAPH_TASK_NODES - 1) / FORMULA_GRAPH_TASK_NODES, [&](size_t task)
+				{
+					size_t end = min(dirty.size(), (task + 1) * FORMULA_GRAPH_TASK_NODES);
+					for(size_t i = task * FORMULA_GRAPH_TASK_NODES; i < end; i++)
+					{
+						evaluateNode(dirty[i]);
+					}
+				});
+			}
+			else
+			{
+				for(size_t index : dirty)
+				{
+					evaluateNode(index);
+				}
+			}
+			for(size_t index : dirty)
+			{
+				nodes[index].dirty = false;
+				successful += nodes[index].status == STATUS_OK;
+				if(nodes[index].changed) markDependentsDirty(index);
+			}
+			evaluated += dirty.size();
+			numberOfDirtyNodes -= dirty.size();
+			dirty.clear();
+		}
+		Calculator::numberOfSuccessfulCalculations.add(successful);
+		return evaluated;
+	}
+
+	double getValue(const string& name, unsigned char& status)
+	{
+		if(numberOfDirtyNodes != 0 || structureChanged) recalculate();
+		const Node& node = nodes[index(name)];
+		status = node.status;
+		return node.value;
+	}
+
+	double getValue(const string& name)
+	{
+		unsigned char status;
+		double value = getValue(name, status);
+		assertSuccess(status);
+		return value;
+	}
+
+	bool isDirty() const
+	{
+		return numberOfDirtyNodes != 0;
+	}
+
+	size_t size() const
+	{
+		return nodes.size();
+	}
+};
+
+#ifdef CALCULATOR_COROUTINES
+struct EvaluationResult
+{
+	double value;
+	unsigned char status;
+};
+
+struct BatchResult
+{
+	string output;
+	FailureSummary failures;
+};
+
+// The executor is any callable taking a nullary job; the coroutine resumes
+// on whichever thread runs the job that finishes the evaluation.
+template<typename Executor>
+class EvaluationAwaitable
+{
+protected:
+	const Calculator& calculator;
+	Executor& executor;
+	string expression;
+	EvaluationResult result;
+
+public:
+	EvaluationAwaitable(const Calculator& calculator, string expression, Executor& executor): calculator(calculator), executor(executor), expression(move(expression)), result{numeric_limits<double>::quiet_NaN(), STATUS_OK} {};
+
+	bool await_ready() const noexcept
+	{
+		return false;
+	}
+
+	void await_suspend(coroutine_handle<> handle)
+	{
+		executor([this, handle]()
+		{
+			if(!calculator.evaluateLine(expression.data(), expression.data() + expression.size(), result.value, result.status)) result.status = STATUS_INVALID_EXPRESSION;
+			handle.resume();
+		});
+	}
+
+	EvaluationResult await_resume() const noexcept
+	{
+		return result;
+	}
+};
+
+template<typename Executor>
+class BatchAwaitable
+{
+protected:
+	const Calculator& calculator;
+	Executor& executor;
+	string input;
+	vector<const char*> chunkStarts;
+	vector<string> outputs;
+	vector<FailureSummary> failures;
+	atomic<size_t> remainingChunks;
+
+public:
+	BatchAwaitable(const Calculator& calculator, string input, Executor& executor): calculator(calculator), executor(executor), input(move(input)), remainingChunks(0) {};
+
+	bool await_ready() const noexcept
+	{
+		return input.empty();
+	}
+
+	void await_suspend(coroutine_handle<> handle)
+	{
+		BatchInput::sliceLines(input.data(), input.data() + input.size(), BATCH_CHUNK_SIZE, chunkStarts);
+		size_t numberOfChunks = chunkStarts.size() - 1;
+		outputs.resize(numberOfChunks);
+		failures.resize(numberOfChunks);
+		remainingChunks = numberOfChunks;
+		for(size_t i = 0; i < numberOfChunks; i++)
+		{
+			executor([this, i, handle]()
+			{
+				calculator.evaluateChunk(chunkStarts[i], chunkStarts[i + 1], outputs[i], failures[i]);
+				if(remainingChunks.fetch_sub(1) == 1) handle.resume();
+			});
+		}
+	}
+
+	BatchResult await_resume()
+	{
+		BatchResult result;
+		for(size_t i = 0; i < outputs.size(); i++)
+		{
+			result.output += outputs[i];
+			result.failures.merge(failures[i]);
+		}
+		return result;
+	}
+};
+#endif
+
+class CalculatorServer
+{
+protected:
+	struct Connection
+	{
+		int descriptor;
+		size_t slot;
+		string input;
+		string output;
+		size_t written;
+		uint32_t interest;
+		bool peerClosed;
+	};
+
+	const Calculator& calculator;
+	int listener;
+	int stopEvent;
+	string unixPath;
+	mutex failuresLock;
+	FailureSummary failures;
+
+	static void configure(int descriptor, bool tcp)
+	{
+		if(tcp)
+		{
+			int enabled = 1;
+			setsockopt(descriptor, IPPROTO_TCP, TCP_NODELAY, &enabled, sizeof(enabled));
+		}
+	}
+
+	void openListener(const string& address)
+	{
+		if(address.compare(0, 5, "unix:") == 0)
+		{
+			unixPath = address.substr(5);
+			sockaddr_un local = {};
+			local.sun_family = AF_UNIX;
+			if(unixPath.empty() || unixPath.size() >= sizeof(local.sun_path)) throwException("Invalid server socket path!");
+			unixPath.copy(local.sun_path, unixPath.size());
+			unlink(unixPath.c_str());
+			listener = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+			if(listener < 0 || bind(listener, (sockaddr*)&local, sizeof(local)) != 0) throwException("Cannot bind server socket!");
+		}
+		else if(address.compare(0, 4, "tcp:") == 0)
+		{
+			string host = "0.0.0.0";
+			string port = address.substr(4);
+			size_t separator = port.rfind(':');
+			if(separator != string::npos)
+			{
+				host = port.substr(0, separator);
+				port = port.substr(separator + 1);
+			}
+			sockaddr_in local = {};
+			local.sin_family = AF_INET;
+			local.sin_port = htons((unsigned short)strtoul(port.c_str(), nullptr, 10));
+			if(inet_pton(AF_INET, host.c_str(), &local.sin_addr) != 1) throwException("Invalid server address!");
+			listener = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+			int enabled = 1;
+			if(listener >= 0) setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &enabled, sizeof(enabled));
+			if(listener < 0 || bind(listener, (sockaddr*)&local, sizeof(local)) != 0) throwException("Cannot bind server socket!");
+		}
+		else throwException("Server address must be tcp:[host:]port or unix:path!");
+		if(listen(listener, SOMAXCONN) != 0) throwException("Cannot listen on server socket!");
+	}
+
+	void acceptConnections(int events, vector<Connection*>& connections)
+	{
+		while(true)
+		{
+			int descriptor = accept4(listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+			if(descriptor < 0) return;
+			configure(descriptor, unixPath.empty());
+			Connection* connection = new Connection{descriptor, connections.size(), string(), string(), 0, EPOLLIN | EPOLLRDHUP, false};
+			epoll_event event = {};
+			event.events = connection->interest;
+			event.data.ptr = connection;
+			if(epoll_ctl(events, EPOLL_CTL_ADD, descriptor, &event) != 0)
+			{
+				close(descriptor);
+				delete connection;
+				continue;
+			}
+			connections.push_back(connection);
+		}
+	}
+
+	void closeConnection(Connection* connection, vector<Connection*>& connections)
+	{
+		close(connection->descriptor);
+		connections[connection->slot] = connections.back();
+		connections[connection->slot]->slot = connection->slot;
+		connections.pop_back();
+		delete connection;
+	}
+
+	bool receive(Connection& connection, FailureSummary& loopFailures)
+	{
+		char buffer[SERVER_READ_SIZE];
+		while(true)
+		{
+			ssize_t count = recv(connection.descriptor, buffer, sizeof(buffer), 0);
+			if(count > 0)
+			{
+				connection.input.append(buffer, count);
+				if(connection.input.size() >= SERVER_MAX_REQUEST_SIZE) break;
+				continue;
+			}
+			if(count == 0) connection.peerClosed = true;
+			else if(errno == EINTR) continue;
+			else if(errno != EAGAIN && errno != EWOULDBLOCK) return false;
+			break;
+		}
+		size_t complete = connection.peerClosed ? connection.input.size() : connection.input.rfind('\n');
+		if(complete == string::npos)
+		{
+			return connection.input.size() <= SERVER_MAX_REQUEST_SIZE;
+		}
+		if(!connection.peerClosed) complete++;
+		const char* begin = connection.input.data();
+		const char* end = begin + complete;
+		while(begin < end)
+		{
+			const char* command = findCommand(begin, end);
+			calculator.evaluateChunk(begin, command, connection.output, loopFailures);
+			if(command == end) break;
+			const char* commandEnd = find(command, end, '\n');
+			answerCommand(command, commandEnd, connection.output);
+			begin = commandEnd + 1;
+		}
+		connection.input.erase(0, complete);
+		return true;
+	}
+
+	static const char* findCommand(const char* begin, const char* end)
+	{
+		for(const char* found = begin; (found = (const char*)memchr(found, '!', end - found)) != nullptr; found++)
+		{
+			if(found == begin || found[-1] == '\n') return found;
+		}
+		return end;
+	}
+
+	void answerCommand(const char* command, const char* end, string& output) const
+	{
+		while(end > command && isBlank(end[-1])) end--;
+		if(string(command, end) == "!metrics" && calculator.getMetrics() != nullptr)
+		{
+			ostringstream metrics;
+			calculator.getMetrics()->exportJson(metrics);
+			output.append(metrics.str());
+			output.push_back('\n');
+		}
+		else output.append("error: Unknown command!\n");
+	}
+
+	bool transmit(Connection& connection, int events)
+	{
+		while(connection.written < connection.output.size())
+		{
+			ssize_t count = send(connection.descriptor, connection.output.data() + connection.written, connection.output.size() - connection.written, MSG_NOSIGNAL);
+			if(count > 0)
+			{
+				connection.written += count;
+				continue;
+			}
+			if(count < 0 && errno == EINTR) continue;
+			if(count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+			return false;
+		}
+		size_t pending = connection.output.size() - connection.written;
+		if(pending == 0)
+		{
+			connection.output.clear();
+			connection.written = 0;
+			if(connection.peerClosed) return false;
+		}
+		// Level-triggered input would fire forever once the peer has shut down
+		// its side, and a client that pipelines without reading would grow the
+		// output without limit, so input is only watched while neither holds.
+		bool reading = !connection.peerClosed && pending <= SERVER_MAX_PENDING_OUTPUT;
+		uint32_t interest = (reading ? (uint32_t)(EPOLLIN | EPOLLRDHUP) : 0u) | (pending != 0 ? (uint32_t)EPOLLOUT : 0u);
+		if(interest != connection.interest)
+		{
+			epoll_event event = {};
+			event.events = interest;
+			event.data.ptr = &connection;
+			epoll_ctl(events, EPOLL_CTL_MOD, connection.descriptor, &event);
+			connection.interest = interest;
+		}
+		return true;
+	}
+
+	void runLoop()
+	{
+		int events = epoll_create1(EPOLL_CLOEXEC);
+		if(events < 0) throwException("Cannot create event loop!");
+		epoll_event event = {};
+		event.events = EPOLLIN | EPOLLEXCLUSIVE;
+		event.data.ptr = &listener;
+		epoll_ctl(events, EPOLL_CTL_ADD, listener, &event);
+		event.events = EPOLLIN;
+		event.data.ptr = &stopEvent;
+		epoll_ctl(events, EPOLL_CTL_ADD, stopEvent, &event);
+		vector<Connection*> connections;
+		FailureSummary loopFailures;
+		epoll_event ready[SERVER_MAX_EVENTS];
+		bool running = true;
+		while(running)
+		{
+			int count = epoll_wait(events, ready, SERVER_MAX_EVENTS, -1);
+			if(count < 0 && errno == EINTR) continue;
+			if(count < 0) break;
+			for(int i = 0; i < count; i++)
+			{
+				void* tag = ready[i].data.ptr;
+				if(tag == &stopEvent)
+				{
+					running = false;
+					continue;
+				}
+				if(tag == &listener)
+				{
+					acceptConnections(events, connections);
+					continue;
+				}
+				Connection* connection = (Connection*)tag;
+				bool open = true;
+				if(ready[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) open = receive(*connection, loopFailures);
+				if(open) open = transmit(*connection, events);
+				if(!open) closeConnection(connection, connections);
+			}
+		}
+		while(!connections.empty())
+		{
+			closeConnection(connections.back(), connections);
+		}
+		close(events);
+		lock_guard<mutex> guard(failuresLock);
+		failures.merge(loopFailures);
+	}
+
+public:
+	CalculatorServer(const Calculator& calculator, const string& address): calculator(calculator), listener(-1)
+	{
+		stopEvent = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+		if(stopEvent < 0) throwException("Cannot create server stop event!");
+		openListener(address);
+	}
+
+	CalculatorServer(const CalculatorServer&) = delete;
+	CalculatorServer& operator=(const CalculatorServer&) = delete;
+
+	~CalculatorServer()
+	{
+		if(listener >= 0) close(listener);
+		close(stopEvent);
+		if(!unixPath.empty()) unlink(unixPath.c_str());
+	}
+
+	void run(size_t numberOfThreads)
+	{
+		if(numberOfThreads == 0) numberOfThreads = thread::hardware_concurrency();
+		vector<thread> loops;
+		for(size_t i = 1; i < numberOfThreads; i++)
+		{
+			loops.emplace_back(&CalculatorServer::runLoop, this);
+		}
+		runLoop();
+		for(size_t i = 0; i < loops.size(); i++)
+		{
+			loops[i].join();
+		}
+	}
+
+	void stop()
+	{
+		unsigned long long value = 1;
+		while(write(stopEvent, &value, sizeof(value)) < 0 && errno == EINTR);
+	}
+
+	int getStopDescriptor() const
+	{
+		return stopEvent;
+	}
+
+	FailureSummary getFailures()
+	{
+		lock_guard<mutex> guard(failuresLock);
+		return failures;
+	}
+};
+
+// Splits a batch into shards of whole lines and farms them out to workers
+// running --server. Up to DISTRIBUTED_SHARDS_PER_WORKER shards are in flight
+// on each connection. A server answers a connection's lines in order, so
+// responses are matched to shards by counting newlines. When a worker's
+// connection fails or stalls for DISTRIBUTED_TIMEOUT_MILLISECONDS, its
+// shards go back to the front of the queue and it is reconnected after a
+// growing delay. After DISTRIBUTED_MAX_ATTEMPTS failures in a row it is
+// given up on. Output is written in input order.
+class BatchCoordinator
+{
+protected:
+	typedef chrono::steady_clock Clock;
+
+	struct Shard
+	{
+		size_t index;
+		string text;
+		size_t lines;
+		size_t attempts;
+	};
+
+	struct Worker
+	{
+		string address;
+		int descriptor;
+		bool connecting;
+		deque<Shard> inFlight;
+		string outgoing;
+		size_t sent;
+		string incoming;
+		size_t scanned;
+		size_t newlines;
+		size_t consecutiveFailures;
+		Clock::time_point retryAt;
+		Clock::time_point lastProgress;
+		Clock::time_point busySince;
+		double busySeconds;
+		unsigned long long shards;
+		unsigned long long lines;
+		unsigned long long retried;
+	};
+
+	vector<Worker> workers;
+	deque<Shard> pending;
+	map<size_t, string> finished;
+	size_t nextShard;
+	size_t nextToWrite;
+	FailureSummary failures;
+
+	static int connectTo(const string& address, bool& connecting)
+	{
+		int descriptor = -1;
+		int result = -1;
+		if(address.compare(0, 5, "unix:") == 0)
+		{
+			sockaddr_un remote = {};
+			remote.sun_family = AF_UNIX;
+			string path = address.substr(5);
+			if(path.empty() || path.size() >= sizeof(remote.sun_path)) throwException("Invalid worker socket path!");
+			path.copy(remote.sun_path, path.size());
+			descriptor = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+			if(descriptor >= 0) result = connect(descriptor, (sockaddr*)&remote, sizeof(remote));
+		}
+		else if(address.compare(0, 4, "tcp:") == 0)
+		{
+			string host = "127.0.0.1";
+			string port = address.substr(4);
+			size_t separator = port.rfind(':');
+			if(separator != string::npos)
+			{
+				host = port.substr(0, separator);
+				port = port.substr(separator + 1);
+			}
+			addrinfo hints = {};
+			hints.ai_family = AF_INET;
+			hints.ai_socktype = SOCK_STREAM;
+			addrinfo* found = nullptr;
+			if(getaddrinfo(host.c_str(), port.c_str(), &hints, &found) != 0 || found == nullptr) return -1;
+			descriptor = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+			if(descriptor >= 0)
+			{
+				int enabled = 1;
+				setsockopt(descriptor, IPPROTO_TCP, TCP_NODELAY, &enabled, sizeof(enabled));
+				result = connect(descriptor, found->ai_addr, found->ai_addrlen);
+			}
+			freeaddrinfo(found);
+		}
+		else throwException("Worker address must be tcp:[host:]port or unix:path!");
+		connecting = result != 0 && errno == EINPROGRESS;
+		if(descriptor >= 0 && result != 0 && !connecting)
+		{
+			close(descriptor);
+			return -1;
+		}
+		return descriptor;
+	}
+
+	// Worker output only carries the description of a failure, which names
+	// its first flag; failures with several flags are counted under that one.
+	static unsigned char statusOf(const char* description, size_t length)
+	{
+		for(size_t i = 0; i < NUMBER_OF_STATUS_FLAGS; i++)
+		{
+			const char* known = describeStatus(1 << i);
+			if(strlen(known) == length && memcmp(known, description, length) == 0) return 1 << i;
+		}
+		return STATUS_OK;
+	}
+
+	// Replies print the shortest representation that reads back exactly,
+	// or the exact decimal under an exact backend, so aggregating them
+	// matches aggregating locally as long as the aggregate uses the same
+	// backend as the workers.
+	void recordResults(const string& output, ResultAggregate* aggregate)
+	{
+		static const char prefix[] = "error: ";
+		ResultAggregate partial(aggregate != nullptr ? aggregate->getNumberBackend() : NUMBERS_DOUBLE);
+		for(size_t begin = 0; begin < output.size();)
+		{
+			size_t end = output.find('\n', begin);
+			if(end == string::npos) end = output.size();
+			if(output.compare(begin, sizeof(prefix) - 1, prefix) == 0) failures.record(statusOf(output.data() + begin + sizeof(prefix) - 1, end - begin - (sizeof(prefix) - 1)));
+			else if(aggregate != nullptr) partial.record(output.data() + begin, output.data() + end);
+			begin = end + 1;
+		}
+		if(aggregate != nullptr) aggregate->merge(partial);
+	}
+
+	// Lines starting with '!' would be taken as server commands, so they get
+	// a leading blank, which the parser skips anyway. Blank lines get no
+	// answer, so they are left out. Every shard ends in a newline, or the
+	// server would wait for the rest of its last line.
+	void addShards(const char* begin, const char* end)
+	{
+		vector<const char*> starts;
+		BatchInput::sliceLines(begin, end, DISTRIBUTED_SHARD_SIZE, starts);
+		for(size_t i = 0; i + 1 < starts.size(); i++)
+		{
+			Shard shard = {0, string(), 0, 0};
+			shard.text.reserve(starts[i + 1] - starts[i] + 1);
+			for(const char* line = starts[i]; line < starts[i + 1];)
+			{
+				const char* lineEnd = find(line, starts[i + 1], '\n');
+				if(find_if_not(line, lineEnd, isBlank) != lineEnd)
+				{
+					if(*line == '!') shard.text.push_back(' ');
+					shard.text.append(line, lineEnd);
+					shard.text.push_back('\n');
+					shard.lines++;
+				}
+				line = lineEnd + 1;
+			}
+			if(shard.lines == 0) continue;
+			shard.index = nextShard++;
+			pending.push_back(move(shard));
+		}
+	}
+
+	bool isDead(const Worker& worker) const
+	{
+		return worker.consecutiveFailures >= DISTRIBUTED_MAX_ATTEMPTS;
+	}
+
+	void becomeIdle(Worker& worker, Clock::time_point now)
+	{
+		worker.busySeconds += chrono::duration<double>(now - worker.busySince).count();
+	}
+
+	void fail(Worker& worker, Clock::time_point now)
+	{
+		close(worker.descriptor);
+		worker.descriptor = -1;
+		worker.connecting = false;
+		if(!worker.inFlight.empty()) becomeIdle(worker, now);
+		while(!worker.inFlight.empty())
+		{
+			Shard& shard = worker.inFlight.back();
+			if(++shard.attempts >= DISTRIBUTED_MAX_ATTEMPTS) throwException("A batch shard failed on every attempt!");
+			pending.push_front(move(shard));
+			worker.inFlight.pop_back();
+			worker.retried++;
+		}
+		worker.outgoing.clear();
+		worker.sent = 0;
+		worker.incoming.clear();
+		worker.scanned = 0;
+		worker.newlines = 0;
+		worker.consecutiveFailures++;
+		worker.retryAt = now + chrono::milliseconds(DISTRIBUTED_RETRY_MILLISECONDS * worker.consecutiveFailures);
+	}
+
+	void dispatch(Worker& worker, Clock::time_point now)
+	{
+		if(worker.descriptor < 0)
+		{
+			if(isDead(worker) || pending.empty() || now < worker.retryAt) return;
+			worker.descriptor = connectTo(worker.address, worker.connecting);
+			if(worker.descriptor < 0)
+			{
+				fail(worker, now);
+				return;
+			}
+			worker.lastProgress = now;
+		}
+		while(!worker.connecting && !pending.empty() && worker.inFlight.size() < DISTRIBUTED_SHARDS_PER_WORKER)
+		{
+			if(worker.inFlight.empty())
+			{
+				worker.busySince = now;
+				worker.lastProgress = now;
+			}
+			worker.outgoing.append(pending.front().text);
+			worker.inFlight.push_back(move(pending.front()));
+			pending.pop_front();
+		}
+	}
+
+	bool transmit(Worker& worker)
+	{
+		if(worker.connecting)
+		{
+			int error = 0;
+			socklen_t length = sizeof(error);
+			if(getsockopt(worker.descriptor, SOL_SOCKET, SO_ERROR, &error, &length) != 0 || error != 0) return false;
+			worker.connecting = false;
+			return true;
+		}
+		while(worker.sent < worker.outgoing.size())
+		{
+			ssize_t count = send(worker.descriptor, worker.outgoing.data() + worker.sent, worker.outgoing.size() - worker.sent, MSG_NOSIGNAL);
+			if(count > 0)
+			{
+				worker.sent += count;
+				continue;
+			}
+			if(count < 0 && errno == EINTR) continue;
+			if(count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+			return false;
+		}
+		if(worker.sent == worker.outgoing.size())
+		{
+			worker.outgoing.clear();
+			worker.sent = 0;
+		}
+		return true;
+	}
+
+	bool receive(Worker& worker, Clock::time_point now)
+	{
+		char buffer[SERVER_READ_SIZE];
+		while(true)
+		{
+			ssize_t count = recv(worker.descriptor, buffer, sizeof(buffer), 0);
+			if(count > 0)
+			{
+				worker.incoming.append(buffer, count);
+				worker.lastProgress = now;
+				continue;
+			}
+			if(count < 0 && errno == EINTR) continue;
+			if(count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+			return false;
+		}
+		while(!worker.inFlight.empty())
+		{
+			Shard& shard = worker.inFlight.front();
+			const char* data = worker.incoming.data();
+			const char* end = data + worker.incoming.size();
+			const char* cursor = data + worker.scanned;
+			while(worker.newlines < shard.lines && (cursor = (const char*)memchr(cursor, '\n', end - cursor)) != nullptr)
+			{
+				cursor++;
+				worker.newlines++;
+			}
+			if(worker.newlines < shard.lines)
+			{
+				worker.scanned = worker.incoming.size();
+				break;
+			}
+			size_t length = cursor - data;
+			finished[shard.index] = worker.incoming.substr(0, length);
+			worker.incoming.erase(0, length);
+			worker.scanned = 0;
+			worker.newlines = 0;
+			worker.shards++;
+			worker.lines += shard.lines;
+			worker.consecutiveFailures = 0;
+			worker.inFlight.pop_front();
+			if(worker.inFlight.empty()) becomeIdle(worker, now);
+		}
+		return true;
+	}
+
+public:
+	BatchCoordinator(const vector<string>& addresses): nextShard(0), nextToWrite(0)
+	{
+		if(addresses.empty()) throwException("Coordinator needs at least one worker!");
+		for(const string& address : addresses)
+		{
+			workers.push_back(Worker{address, -1, false, deque<Shard>(), string(), 0, string(), 0, 0, 0, Clock::now(), Clock::now(), Clock::now(), 0, 0, 0, 0});
+		}
+	}
+
+	BatchCoordinator(const BatchCoordinator&) = delete;
+	BatchCoordinator& operator=(const BatchCoordinator&) = delete;
+
+	~BatchCoordinator()
+	{
+		for(Worker& worker : workers)
+		{
+			if(worker.descriptor >= 0) close(worker.descriptor);
+		}
+	}
+
+	FailureSummary run(BatchInput& input, ostream& out, ResultAggregate* aggregate = nullptr)
+	{
+		bool inputDone = false;
+		vector<pollfd> descriptors;
+		vector<Worker*> polled;
+		while(true)
+		{
+			Clock::time_point now = Clock::now();
+			size_t window = workers.size() * DISTRIBUTED_SHARDS_PER_WORKER;
+			while(!inputDone && pending.size() < window && nextShard - nextToWrite < DISTRIBUTED_WINDOW_SHARDS)
+			{
+				const char* begin;
+				const char* end;
+				if(input.nextBlock(begin, end)) addShards(begin, end);
+				else inputDone = true;
+			}
+			bool working = !pending.empty();
+			for(Worker& worker : workers)
+			{
+				dispatch(worker, now);
+				working |= !worker.inFlight.empty();
+			}
+			while(!finished.empty() && finished.begin()->first == nextToWrite)
+			{
+				const string& output = finished.begin()->second;
+				if(aggregate == nullptr) out.write(output.data(), output.size());
+				recordResults(output, aggregate);
+				finished.erase(finished.begin());
+				nextToWrite++;
+			}
+			if(inputDone && !working) break;
+			bool reachable = false;
+			descriptors.clear();
+			polled.clear();
+			for(Worker& worker : workers)
+			{
+				reachable |= !isDead(worker);
+				if(worker.descriptor < 0) continue;
+				short events = POLLIN | (worker.connecting || !worker.outgoing.empty() ? POLLOUT : 0);
+				descriptors.push_back(pollfd{worker.descriptor, events, 0});
+				polled.push_back(&worker);
+			}
+			if(!reachable) throwException("No worker is reachable!");
+			int count = poll(descriptors.data(), descriptors.size(), DISTRIBUTED_POLL_MILLISECONDS);
+			if(count < 0 && errno != EINTR) throwException("Cannot wait for workers!");
+			now = Clock::now();
+			for(size_t i = 0; i < descriptors.size(); i++)
+			{
+				Worker& worker = *polled[i];
+				short events = descriptors[i].revents;
+				bool open = !(events & POLLERR) && !(events & POLLNVAL);
+				if(open && (events & POLLOUT)) open = transmit(worker);
+				if(open && (events & (POLLIN | POLLHUP))) open = receive(worker, now);
+				if(open && !worker.inFlight.empty() && now - worker.lastProgress > chrono::milliseconds(DISTRIBUTED_TIMEOUT_MILLISECONDS)) open = false;
+				if(!open) fail(worker, now);
+			}
+		}
+		out.flush();
+		return failures;
+	}
+
+	// Per-worker throughput counts only the time a worker had shards in
+	// flight; scaling efficiency compares the aggregate rate to their sum.
+	void printThroughput(ostream& out, double seconds) const
+	{
+		unsigned long long total = 0;
+		double sumOfRates = 0;
+		for(const Worker& worker : workers)
+		{
+			double rate = worker.busySeconds > 0 ? worker.lines / worker.busySeconds : 0;
+			out << "Worker " << worker.address << ": " << worker.shards << " shard(s), " << worker.lines << " line(s), " << (unsigned long long)rate << " lines/s";
+			if(worker.retried != 0) out << ", " << worker.retried << " shard(s) retried";
+			if(isDead(worker)) out << ", unreachable";
+			out << endl;
+			total += worker.lines;
+			sumOfRates += rate;
+		}
+		double rate = seconds > 0 ? total / seconds : 0;
+		out << "Total: " << total << " line(s) in " << seconds << " s, " << (unsigned long long)rate << " lines/s";
+		if(sumOfRates > 0) out << ", scaling efficiency " << (int)(100 * rate / sumOfRates + 0.5) << "%";
+		out << endl;
+	}
+};
+
+class CalculatorBenchmark
+{
+protected:
+	const Calculator& calculator;
+	size_t repetitions;
+	vector<double> left;
+	vector<double> right;
+	vector<string> results;
+	volatile double sink;
+
+	static double percentile(const vector<double>& sorted, double fraction)
+	{
+		size_t rank = (size_t)ceil(fraction * sorted.size());
+		return sorted[rank == 0 ? 0 : rank - 1];
+	}
+
+	static string chain(size_t length, bool withVariable)
+	{
+		const char* symbols[] = {"+", "*", "-", "/"};
+		string text = withVariable ? "x" : "1.25";
+		for(size_t i = 0; i < length; i++)
+		{
+			text += ' ';
+			text += symbols[i % 4];
+			text += ' ';
+			text += withVariable && i % 2 == 1 ? "x" : to_string(1.5 + i % 7);
+		}
+		return text;
+	}
+
+	template<typename Body>
+	void measure(const string& benchmarkName, size_t operationsPerRun, Body body)
+	{
+		body();
+		vector<double> nanosecondsPerOperation(repetitions);
+		for(size_t i = 0; i < repetitions; i++)
+		{
+			chrono::steady_clock::time_point start = chrono::steady_clock::now();
+			body();
+			chrono::steady_clock::time_point stop = chrono::steady_clock::now();
+			nanosecondsPerOperation[i] = chrono::duration<double, nano>(stop - start).count() / operationsPerRun;
+		}
+		sort(nanosecondsPerOperation.begin(), nanosecondsPerOperation.end());
+		double median = percentile(nanosecondsPerOperation, 0.5);
+		char line[512];
+		snprintf(line, sizeof(line), "{\"name\": \"%s\", \"operations\": %zu, \"ns_per_op\": %.3f, \"ops_per_second\": %.0f, \"min\": %.3f, \"p50\": %.3f, \"p90\": %.3f, \"p99\": %.3f, \"max\": %.3f}",
+			benchmarkName.c_str(), operationsPerRun, median, 1e9 / median, nanosecondsPerOperation.front(), median,
+			percentile(nanosecondsPerOperation, 0.9), percentile(nanosecondsPerOperation, 0.99), nanosecondsPerOperation.back());
+		results.push_back(line);
+	}
+
+	void measureOperations()
+	{
+		for(size_t i = 0; i < calculator.operations.size(); i++)
+		{
+			Operation* operation = calculator.operations[i];
+			const string& symbol = operation->getSymbol();
+			measure("operation/" + symbol + "/execute", BENCHMARK_OPERANDS, [&]()
+			{
+				double total = 0;
+				unsigned char status = STATUS_OK;
+				for(size_t j = 0; j < BENCHMARK_OPERANDS; j++)
+				{
+					total += operation->execute(left[j], right[j], status);
+				}
+				sink = total;
+			});
+			measure("calculator/" + symbol + "/calculate", BENCHMARK_OPERANDS, [&]()
+			{
+				double total = 0;
+				unsigned char status = STATUS_OK;
+				for(size_t j = 0; j < BENCHMARK_OPERANDS; j++)
+				{
+					total += calculator.calculate(left[j], right[j], symbol.data(), symbol.size(), status);
+				}
+				sink = total;
+			});
+		}
+	}
+
+	void measureChains()
+	{
+		const size_t lengths[] = {1, 4, 16, 64};
+		for(size_t length : lengths)
+		{
+			string text = chain(length, false);
+			const char* begin = text.data();
+			const char* end = begin + text.size();
+			measure("parse/" + to_string(length), 1000, [&]()
+			{
+				size_t instructions = 0;
+				for(size_t j = 0; j < 1000; j++)
+				{
+					instructions += calculator.compile(begin, end).getNumberOfInstructions();
+				}
+				sink = instructions;
+			});
+			measure("chain/" + to_string(length), 1000, [&]()
+			{
+				double total = 0;
+				for(size_t j = 0; j < 1000; j++)
+				{
+					double result = 0;
+					unsigned char status;
+					calculator.evaluateLine(begin, end, result, status);
+					total += result;
+				}
+				sink = total;
+			});
+		}
+	}
+
+	void measureBatches()
+	{
+		const size_t lengths[] = {1, 16};
+		const size_t batchSizes[] = {1, 64, 4096};
+		for(size_t length : lengths)
+		{
+			string line = chain(length, false) + "\n";
+			for(size_t batchSize : batchSizes)
+			{
+				string batch;
+				for(size_t j = 0; j < batchSize; j++)
+				{
+					batch += line;
+				}
+				size_t runs = (4096 + batchSize - 1) / batchSize;
+				string output;
+				FailureSummary failures;
+				measure("batch/" + to_string(length) + "/" + to_string(batchSize), runs * batchSize, [&]()
+				{
+					for(size_t j = 0; j < runs; j++)
+					{
+						output.clear();
+						calculator.evaluateChunk(batch.data(), batch.data() + batch.size(), output, failures);
+					}
+					sink = output.size();
+				});
+			}
+			CompiledExpression expression = calculator.compile(chain(length, true));
+			const double* columns[] = {left.data()};
+			vector<double> values(BENCHMARK_OPERANDS);
+			vector<unsigned char> statuses(BENCHMARK_OPERANDS);
+			measure("columns/" + to_string(length) + "/" + to_string(BENCHMARK_OPERANDS), BENCHMARK_OPERANDS, [&]()
+			{
+				expression.evaluateColumns(columns, values.data(), statuses.data(), BENCHMARK_OPERANDS);
+				sink = values[BENCHMARK_OPERANDS - 1];
+			});
+		}
+	}
+
+	// Scalar evaluation of one tape, interpreted and, past the call-count
+	// threshold, as native code.
+	void measureTiers()
+	{
+		CompiledExpression expression = calculator.compile(chain(16, true));
+		double total = 0;
+		measure("tape/interpreted/16", BENCHMARK_OPERANDS, [&]()
+		{
+			unsigned char status = STATUS_OK;
+			for(size_t i = 0; i < BENCHMARK_OPERANDS; i++)
+			{
+				total += expression.interpret(&left[i], status);
+			}
+			sink = total;
+		});
+#ifdef CALCULATOR_JIT
+		measure("tape/native/16", BENCHMARK_OPERANDS, [&]()
+		{
+			unsigned char status = STATUS_OK;
+			for(size_t i = 0; i < BENCHMARK_OPERANDS; i++)
+			{
+				total += expression.evaluate(&left[i], status);
+			}
+			sink = total;
+		});
+#endif
+	}
+
+	void measureNumberBackends()
+	{
+		const NumberBackend backends[] = {NUMBERS_DOUBLE, NUMBERS_FIXED_POINT, NUMBERS_DECIMAL128, NUMBERS_BIG_DECIMAL};
+		const char* names[] = {"double", "fixed", "decimal128", "big"};
+		string batch;
+		for(size_t j = 0; j < 256; j++)
+		{
+			batch += chain(16, false) + "\n";
+		}
+		for(size_t i = 0; i < sizeof(backends) / sizeof(backends[0]); i++)
+		{
+			Calculator numbers(calculator);
+			numbers.setNumberBackend(backends[i]);
+			string output;
+			FailureSummary failures;
+			measure(string("numbers/") + names[i] + "/16", 256, [&]()
+			{
+				output.clear();
+				numbers.evaluateChunk(batch.data(), batch.data() + batch.size(), output, failures);
+				sink = output.size();
+			});
+		}
+	}
+
+	void measureFormulaGraph()
+	{
+		FormulaGraph graph(calculator);
+		for(size_t i = 0; i < 100; i++)
+		{
+			graph.setInput("input" + to_string(i), left[i]);
+		}
+		for(size_t i = 0; i < 1000; i++)
+		{
+			graph.define("cell" + to_string(i), "input" + to_string(i % 100) + " * 1.5 + input" + to_string(i * 7 % 100));
+		}
+		for(size_t i = 0; i < 10; i++)
+		{
+			string total = "cell" + to_string(i);
+			for(size_t j = 1; j < 100; j++)
+			{
+				total += " + cell" + to_string(i + j * 10);
+			}
+			graph.define("total" + to_string(i), total);
+		}
+		graph.recalculate();
+		size_t tick = 0;
+		measure("graph/1110/tick", 1, [&]()
+		{
+			graph.setInput("input" + to_string(tick % 100), right[tick % BENCHMARK_OPERANDS]);
+			tick++;
+			sink = graph.recalculate();
+		});
+	}
+
+public:
+	CalculatorBenchmark(const Calculator& calculator, size_t repetitions = BENCHMARK_REPETITIONS): calculator(calculator), repetitions(repetitions), sink(0)
+	{
+		if(repetitions == 0) throwException("Benchmark needs at least one repetition!");
+		left.resize(BENCHMARK_OPERANDS);
+		right.resize(BENCHMARK_OPERANDS);
+		for(size_t i = 0; i < BENCHMARK_OPERANDS; i++)
+		{
+			left[i] = 1.0 + (i % 97) * 0.25;
+			right[i] = 1.0 + (i % 13) * 0.125;
+		}
+	}
+
+	void run(ostream& out)
+	{
+		results.clear();
+		measureOperations();
+		measureChains();
+		measureBatches();
+		measureTiers();
+		measureNumberBackends();
+		measureFormulaGraph();
+		out << "{\"calculator\": \"" << calculator.name << "\", \"repetitions\": " << repetitions << ", \"benchmarks\": [\n";
+		for(size_t i = 0; i < results.size(); i++)
+		{
+			out << "  " << results[i] << (i + 1 < results.size() ? ",\n" : "\n");
+		}
+		out << "]}" << endl;
+	}
+};
+
+int runBenchmarkMode(size_t repetitions)
+{
+	Calculator calc("benchmark");
+	calc.addOperations(OperationRegistry::global());
+	CalculatorBenchmark benchmark(calc, repetitions);
+	benchmark.run(cout);
+	return 0;
+}
+
+// Cross-checks evaluation paths that must agree with each other or with
+// known answers; each failed check is reported on its own line.
+class CalculatorSelfTest
+{
+protected:
+	const Calculator& calculator;
+	vector<string> formulas;
+	vector<double> samples;
+	size_t checks;
+	vector<string> failures;
+
+	void check(bool passed, const string& description)
+	{
+		checks++;
+		if(!passed) failures.push_back(description);
+	}
+
+	// Bit for bit, except that any two NaNs match: which payload survives
+	// an operation on NaN depends on operand order, which is not fixed.
+	static bool sameBits(double a, double b)
+	{
+		return memcmp(&a, &b, sizeof(a)) == 0 || (isnan(a) && isnan(b));
+	}
+
+	double sample(size_t row, size_t variable) const
+	{
+		for(size_t i = 0; i < variable; i++)
+		{
+			row /= samples.size();
+		}
+		return samples[row % samples.size()];
+	}
+
+	size_t numberOfRows() const
+	{
+		return samples.size() * samples.size();
+	}
+
+	// One column per variable, covering every pair of samples for the
+	// first two.
+	void fillColumns(const CompiledExpression& expression, vector<vector<double>>& columns, vector<const double*>& pointers) const
+	{
+		size_t numberOfVariables = expression.getNumberOfVariables();
+		columns.assign(numberOfVariables, vector<double>(numberOfRows()));
+		pointers.resize(numberOfVariables);
+		for(size_t k = 0; k < numberOfVariables; k++)
+		{
+			for(size_t r = 0; r < numberOfRows(); r++)
+			{
+				columns[k][r] = sample(r, k);
+			}
+			pointers[k] = columns[k].data();
+		}
+	}
+
+	// The scalar interpreter is the reference every other path is held to.
+	template<typename Evaluator>
+	void evaluateRows(const vector<vector<double>>& columns, vector<double>& results, vector<unsigned char>& statuses, Evaluator evaluator) const
+	{
+		vector<double> values(columns.size() + 1);
+		results.assign(numberOfRows(), 0);
+		statuses.assign(numberOfRows(), STATUS_OK);
+		for(size_t r = 0; r < numberOfRows(); r++)
+		{
+			for(size_t k = 0; k < columns.size(); k++)
+			{
+				values[k] = columns[k][r];
+			}
+			results[r] = evaluator(values.data(), statuses[r]);
+		}
+	}
+
+	// Results of failed rows are unspecified, so only statuses are compared
+	// for them.
+	void compareRows(const string& name, const vector<double>& expected, const vector<unsigned char>& expectedStatuses, const vector<double>& results, const vector<unsigned char>& statuses)
+	{
+		size_t mismatches = 0;
+		for(size_t i = 0; i < expected.size(); i++)
+		{
+			if(statuses[i] != expectedStatuses[i] || (statuses[i] == STATUS_OK && !sameBits(results[i], expected[i]))) mismatches++;
+		}
+		check(mismatches == 0, name + ": " + to_string(mismatches) + " of " + to_string(expected.size()) + " rows differ");
+	}
+
+	static string formatNumber(double n)
+	{
+		string text;
+		appendNumber(text, n);
+		return text;
+	}
+
+	void checkPrecedence()
+	{
+		struct Case
+		{
+			const char* line;
+			double expected;
+		};
+		const Case cases[] = {
+			{"2 ** 3 ** 2", 512}, {"2 ** 2 ** 3 / 4", 64}, {"2 - 3 - 4", -5}, {"2 - (3 - 4)", 3},
+			{"8 / 4 / 2", 1}, {"2 + 3 * 4", 14}, {"(2 + 3) * 4", 20}, {"2 * 3 ** 2", 18}
+		};
+		for(const Case& test : cases)
+		{
+			double result = 0;
+			unsigned char status = STATUS_OK;
+			calculator.evaluateLine(test.line, test.line + strlen(test.line), result, status);
+			check(status == STATUS_OK && result == test.expected, string("precedence/parse/") + test.line + ": got " + (status == STATUS_OK ? formatNumber(result) : describeStatus(status)));
+			status = STATUS_OK;
+			result = calculator.compile(test.line).evaluate(nullptr, status);
+			check(status == STATUS_OK && result == test.expected, string("precedence/tape/") + test.line + ": got " + (status == STATUS_OK ? formatNumber(result) : describeStatus(status)));
+		}
+	}
+
+	void checkNumberBackends()
+	{
+		const NumberBackend backends[] = {NUMBERS_DOUBLE, NUMBERS_FIXED_POINT, NUMBERS_DECIMAL128, NUMBERS_BIG_DECIMAL};
+		const char* names[] = {"double", "fixed", "decimal128", "big"};
+		const char* lines[] = {"0.1 + 0.2", "1 / 3", "2 / 3", "1.1 * 1.1", "0.1 * 3 - 0.3", "10 ** 20 + 1", "1 / 0"};
+		const char* expected[][sizeof(lines) / sizeof(lines[0])] = {
+			{"0.30000000000000004", "0.3333333333333333", "0.6666666666666666", "1.2100000000000002", "5.551115123125783e-17", "1e+20", "error: Cannot divide by zero!"},
+			{"0.3", "0.333333", "0.666667", "1.21", "0", "error: Result is out of range!", "error: Cannot divide by zero!"},
+			{"0.3", "0.3333333333333333333333333333333333", "0.6666666666666666666666666666666667", "1.21", "0", "100000000000000000001", "error: Cannot divide by zero!"},
+			{"0.3", "0.33333333333333333333333333333333333333333333333333", "0.66666666666666666666666666666666666666666666666667", "1.21", "0", "100000000000000000001", "error: Cannot divide by zero!"}
+		};
+		for(size_t i = 0; i < sizeof(backends) / sizeof(backends[0]); i++)
+		{
+			Calculator numbers(calculator);
+			numbers.setNumberBackend(backends[i]);
+			for(size_t j = 0; j < sizeof(lines) / sizeof(lines[0]); j++)
+			{
+				string output;
+				FailureSummary summary;
+				numbers.evaluateChunk(lines[j], lines[j] + strlen(lines[j]), output, summary);
+				if(!output.empty() && output.back() == '\n') output.pop_back();
+				check(output == expected[i][j], string("numbers/") + names[i] + "/" + lines[j] + ": got " + output + ", expected " + expected[i][j]);
+			}
+		}
+	}
+
+	// Fast math is covered for its fused multiply-add instructions.
+	void checkColumnInterpreter(bool fastMath)
+	{
+		Calculator compiler(calculator);
+		compiler.setFastMath(fastMath);
+		string mode = fastMath ? "fast-math/" : "";
+		for(const string& formula : formulas)
+		{
+			CompiledExpression expression = compiler.compile(formula);
+			vector<vector<double>> columns;
+			vector<const double*> pointers;
+			fillColumns(expression, columns, pointers);
+			vector<double> expected;
+			vector<unsigned char> expectedStatuses;
+			evaluateRows(columns, expected, expectedStatuses, [&](const double* values, unsigned char& status) { return expression.interpret(values, status); });
+			vector<double> results(numberOfRows());
+			vector<unsigned char> statuses(numberOfRows(), STATUS_OK);
+			expression.interpretColumns(pointers.data(), results.data(), statuses.data(), numberOfRows());
+			compareRows("columns/interpreted/" + mode + formula, expected, expectedStatuses, results, statuses);
+		}
+	}
+
+	// Without fast math every path must give exactly what pow() gives for
+	// small integer exponents; with it, compiled squaring chains may not.
+	void checkPowers()
+	{
+		const size_t numberOfBases = 2500;
+		vector<double> bases(numberOfBases);
+		for(size_t i = 0; i < numberOfBases; i++)
+		{
+			bases[i] = 0.5 + i * 0.001;
+		}
+		const double* columns[] = {bases.data()};
+		vector<double> results(numberOfBases);
+		vector<unsigned char> statuses(numberOfBases);
+		for(int exponent = -POWER_SQUARING_LIMIT; exponent <= POWER_SQUARING_LIMIT; exponent++)
+		{
+			string formula = "x ** " + to_string(exponent);
+			CompiledExpression expression = calculator.compile(formula);
+			fill(statuses.begin(), statuses.end(), STATUS_OK);
+			expression.interpretColumns(columns, results.data(), statuses.data(), numberOfBases);
+			size_t mismatches = 0;
+			for(size_t i = 0; i < numberOfBases; i++)
+			{
+				string line;
+				appendNumber(line, bases[i]);
+				line += " ** " + to_string(exponent);
+				double parsed = 0;
+				unsigned char status = STATUS_OK;
+				calculator.evaluateLine(line.data(), line.data() + line.size(), parsed, status);
+				unsigned char interpretedStatus = STATUS_OK;
+				double interpreted = expression.interpret(&bases[i], interpretedStatus);
+				double expected = pow(bases[i], (double)exponent);
+				if(status != STATUS_OK || !sameBits(parsed, expected) || !sameBits(interpreted, expected) || !sameBits(results[i], expected)) mismatches++;
+			}
+			check(mismatches == 0, "powers/" + formula + ": " + to_string(mismatches) + " of " + to_string(numberOfBases) + " bases differ from pow()");
+		}
+	}
+
+	// Native code is built directly instead of waiting for JIT_THRESHOLD
+	// evaluations, and both of its entry points are compared with the
+	// interpreter. Fast math is covered for its fused multiply-add
+	// instructions.
+	void checkNativeCode(bool fastMath)
+	{
+#ifdef CALCULATOR_JIT
+		Calculator compiler(calculator);
+		compiler.setFastMath(fastMath);
+		string mode = fastMath ? "fast-math/" : "";
+		for(const string& formula : formulas)
+		{
+			CompiledExpression expression = compiler.compile(formula);
+			vector<vector<double>> columns;
+			vector<const double*> pointers;
+			fillColumns(expression, columns, pointers);
+			vector<double> expected;
+			vector<unsigned char> expectedStatuses;
+			evaluateRows(columns, expected, expectedStatuses, [&](const double* values, unsigned char& status) { return expression.interpret(values, status); });
+			NativeExpression native(expression.instructions, expression.constants, expression.powers, expression.maxStackDepth, expression.numberOfSavedValues);
+			check(native.isCompiled(), "native/" + mode + formula + ": not compiled");
+			if(!native.isCompiled()) continue;
+			vector<double> results;
+			vector<unsigned char> statuses;
+			evaluateRows(columns, results, statuses, [&](const double* values, unsigned char& status) { return native.evaluate(values, status); });
+			compareRows("native/scalar/" + mode + formula, expected, expectedStatuses, results, statuses);
+			fill(statuses.begin(), statuses.end(), STATUS_OK);
+			native.evaluateColumns(pointers.data(), results.data(), statuses.data(), numberOfRows());
+			compareRows("native/columns/" + mode + formula, expected, expectedStatuses, results, statuses);
+		}
+#else
+		(void)fastMath;
+#endif
+	}
+
+	static bool sameTape(const CompiledExpression& a, const CompiledExpression& b)
+	{
+		if(a.instructions.size() != b.instructions.size() || a.constants.size() != b.constants.size() || a.powers.size() != b.powers.size() || a.calls.size() != b.calls.size()) return false;
+		if(a.variables != b.variables || a.maxStackDepth != b.maxStackDepth || a.numberOfSavedValues != b.numberOfSavedValues) return false;
+		for(size_t i = 0; i < a.instructions.size(); i++)
+		{
+			if(a.instructions[i].opcode != b.instructions[i].opcode || a.instructions[i].operand != b.instructions[i].operand) return false;
+		}
+		for(size_t i = 0; i < a.constants.size(); i++)
+		{
+			if(!sameBits(a.constants[i], b.constants[i])) return false;
+		}
+		for(size_t i = 0; i < a.powers.size(); i++)
+		{
+			const PowerPlan& x = a.powers[i];
+			const PowerPlan& y = b.powers[i];
+			if(x.kind != y.kind || x.integerExponent != y.integerExponent || !sameBits(x.exponent, y.exponent) || x.zeroBaseStatus != y.zeroBaseStatus || x.negativeBaseStatus != y.negativeBaseStatus) return false;
+		}
+		for(size_t i = 0; i < a.calls.size(); i++)
+		{
+			if(a.calls[i]->getSymbol() != b.calls[i]->getSymbol()) return false;
+		}
+		return true;
+	}
+
+	// Saves the corpus with and without fast math through one calculator
+	// each and reloads both through others, so every tape must come from
+	// the file and the second save must keep the first one's tapes.
+	void checkTapeCache()
+	{
+		char path[] = "/tmp/calculator-self-test.XXXXXX";
+		int descriptor = mkstemp(path);
+		check(descriptor >= 0, "tapes: cannot create a temporary file");
+		if(descriptor < 0) return;
+		close(descriptor);
+		for(bool fastMath : {false, true})
+		{
+			Calculator writer(calculator);
+			writer.setFastMath(fastMath);
+			writer.enableTapeCache(path);
+			for(const string& formula : formulas)
+			{
+				writer.compile(formula);
+			}
+			Calculator copy(writer);
+			check(copy.getTapeCache() == writer.getTapeCache(), "tapes: a copy does not share the unsaved tapes");
+			writer.saveTapeCache();
+		}
+		for(bool fastMath : {false, true})
+		{
+			string name = fastMath ? "tapes/fast/" : "tapes/";
+			Calculator reference(calculator);
+			reference.setFastMath(fastMath);
+			Calculator reader(reference);
+			reader.enableTapeCache(path);
+			for(const string& formula : formulas)
+			{
+				check(sameTape(reader.compile(formula), reference.compile(formula)), name + formula + ": reloaded tape differs");
+			}
+			check(reader.getTapeCache()->getNumberOfHits() == formulas.size(), name + to_string(reader.getTapeCache()->getNumberOfHits()) + " of " + to_string(formulas.size()) + " tapes reloaded");
+		}
+		unlink(path);
+	}
+
+public:
+	CalculatorSelfTest(const Calculator& calculator): calculator(calculator), checks(0)
+	{
+		formulas = {
+			"x + y * 2",
+			"x - y - 4",
+			"x * y + x * 1.5 - y",
+			"1.5 * x - y * 0.25",
+			"(x - y) * (x + y) / 3",
+			"x / y / (y - 1)",
+			"x ** 3 - y ** 2",
+			"x ** 0.5 + y ** -2",
+			"(x + 1) * (x + 1) * (x + 1) - y",
+			"((x + y) * (x - y) + (x * 2 - y * 3)) * ((x / 4 + y / 5) - (x * y + 1))",
+			"x + 2.5 * y - x / 3.5 * y + 1.25 - x * y * y + 4 / x - y * 0.5"
+		};
+		samples = {-3.5, -1, -0.0, 0, 0.5, 1, 2, 3.25, 7, 1e-300, 1e10, 1e300};
+	}
+
+	// Returns whether every check passed.
+	bool run(ostream& out)
+	{
+		checks = 0;
+		failures.clear();
+		checkPrecedence();
+		checkNumberBackends();
+		checkPowers();
+		checkColumnInterpreter(false);
+		checkColumnInterpreter(true);
+		checkNativeCode(false);
+		checkNativeCode(true);
+		checkTapeCache();
+		for(const string& failure : failures)
+		{
+			out << "FAIL " << failure << '\n';
+		}
+		out << checks << " check(s), " << failures.size() << " failed" << endl;
+		return failures.empty();
+	}
+};
+
+int runSelfTestMode()
+{
+	Calculator calc("self-test");
+	calc.addOperations(OperationRegistry::global());
+	CalculatorSelfTest test(calc);
+	return test.run(cout) ? 0 : 1;
+}
+
+int serverStopDescriptor = -1;
+
+void stopServer(int)
+{
+	unsigned long long value = 1;
+	if(write(serverStopDescriptor, &value, sizeof(value)) < 0) return;
+}
+
+void writeMetrics(const Calculator& calc, const char* metricsPath, bool metricsJson)
+{
+	if(metricsPath == nullptr) return;
+	if(string(metricsPath) == "-")
+	{
+		calc.getMetrics()->exportTo(cerr, metricsJson);
+		return;
+	}
+	ofstream out(metricsPath);
+	if(!out) throwException("Cannot open metrics file!");
+	calc.getMetrics()->exportTo(out, metricsJson);
+}
+
+NumberBackend parseNumberBackend(const string& name)
+{
+	if(name == "double") return NUMBERS_DOUBLE;
+	if(name == "fixed") return NUMBERS_FIXED_POINT;
+	if(name == "decimal128") return NUMBERS_DECIMAL128;
+	if(name == "big") return NUMBERS_BIG_DECIMAL;
+	throwException("Unknown number backend!");
+	return NUMBERS_DOUBLE;
+}
+
+ColumnDevice parseColumnDevice(const string& name)
+{
+	if(name == "cpu") return COLUMN_DEVICE_CPU;
+	if(name == "opencl") return COLUMN_DEVICE_OPENCL;
+	if(name == "auto") return COLUMN_DEVICE_AUTO;
+	throwException("Unknown column device!");
+	return COLUMN_DEVICE_CPU;
+}
+
+int runServerMode(const char* address, size_t numberOfThreads, size_t cacheCapacity, const char* metricsPath, bool metricsJson, NumberBackend numbers)
+{
+	Calculator calc("server");
+	calc.addOperations(OperationRegistry::global());
+	calc.setNumberBackend(numbers);
+	calc.enableCache(cacheCapacity);
+	calc.enableMetrics(metricsPath != nullptr);
+	CalculatorServer server(calc, address);
+	serverStopDescriptor = server.getStopDescriptor();
+	signal(SIGINT, stopServer);
+	signal(SIGTERM, stopServer);
+	server.run(numberOfThreads);
+	server.getFailures().print(cerr);
+	cerr << "Successful calculations: " << calc.getNumberOfSuccessfulCalculations() << endl;
+	writeMetrics(calc, metricsPath, metricsJson);
+	return 0;
+}
+
+int runBatchMode(const char* path, size_t numberOfThreads, size_t cacheCapacity, const char* metricsPath, bool metricsJson, NumberBackend numbers, bool aggregating)
+{
+	ios::sync_with_stdio(false);
+	Calculator calc("batch");
+	calc.addOperations(OperationRegistry::global());
+	calc.setNumberBackend(numbers);
+	calc.enableCache(cacheCapacity);
+	calc.enableMetrics(metricsPath != nullptr);
+	BatchInput in(path);
+	FailureSummary failures;
+	ResultAggregate aggregate(numbers);
+	if(numberOfThreads == 1)
+	{
+		failures = calc.runBatch(in, cout, aggregating ? &aggregate : nullptr);
+	}
+	else
+	{
+		ThreadPool pool(numberOfThreads);
+		failures = calc.runParallelBatch(in, cout, pool, aggregating ? &aggregate : nullptr);
+	}
+	if(aggregating) aggregate.print(cout);
+	failures.print(cerr);
+	if(cacheCapacity != 0) cerr << "Cache hits: " << calc.getNumberOfCacheHits() << ", misses: " << calc.getNumberOfCacheMisses() << endl;
+	writeMetrics(calc, metricsPath, metricsJson);
+	return 0;
+}
+
+int runCoordinatorMode(const char* path, const vector<string>& workers, bool aggregating, NumberBackend numbers)
+{
+	ios::sync_with_stdio(false);
+	BatchInput in(path);
+	BatchCoordinator coordinator(workers);
+	ResultAggregate aggregate(numbers);
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	FailureSummary failures = coordinator.run(in, cout, aggregating ? &aggregate : nullptr);
+	if(aggregating) aggregate.print(cout);
+	failures.print(cerr);
+	coordinator.printThroughput(cerr, chrono::duration<double>(chrono::steady_clock::now() - start).count());
+	return 0;
+}
+
+int runColumnarMode(const char* formula, const char* inputPath, const char* outputPath, size_t numberOfThreads, bool fastMath, ColumnDevice device, const char* tapeCachePath)
+{
+	ios::sync_with_stdio(false);
+	Calculator calc("columnar");
+	calc.addOperations(OperationRegistry::global());
+	calc.setFastMath(fastMath);
+	calc.enableTapeCache(tapeCachePath);
+	CompiledExpression expression = calc.compile(formula);
+	calc.saveTapeCache();
+	ColumnarReader in(inputPath);
+	ofstream file;
+	bool toStandardOutput = outputPath == nullptr || string(outputPath) == "-";
+	if(!toStandardOutput)
+	{
+		file.open(outputPath, ios::binary);
+		if(!file) throwException("Cannot open columnar output file!");
+	}
+	ColumnarWriter out(toStandardOutput ? cout : file, vector<string>(1, "result"));
+	FailureSummary failures;
+	if(numberOfThreads == 1)
+	{
+		failures = calc.runColumnarBatch(expression, in, out, nullptr, device);
+	}
+	else
+	{
+		ThreadPool pool(numberOfThreads);
+		failures = calc.runColumnarBatch(expression, in, out, &pool, device);
+	}
+	failures.print(cerr);
+	return 0;
+}
+
+// Each line of a configuration file is an option without its leading
+// dashes, optionally followed by '=' and its value, as in "threads = 4".
+// Blank lines and lines starting with '#' are skipped. The options take the
+// place of --config on the command line, so later arguments override them.
+void readConfiguration(const char* path, vector<string>& arguments)
+{
+	ifstream in(path);
+	if(!in) throwException("Cannot open configuration file!");
+	string line;
+	while(getline(in, line))
+	{
+		size_t begin = line.find_first_not_of(" \t\r");
+		if(begin == string::npos || line[begin] == '#') continue;
+		size_t separator = line.find('=', begin);
+		string option = line.substr(begin, separator == string::npos ? string::npos : separator - begin);
+		option.erase(option.find_last_not_of(" \t\r") + 1);
+		if(option.empty() || option == "config") throwException("Invalid option in configuration file!");
+		arguments.push_back("--" + option);
+		if(separator == string::npos) continue;
+		size_t valueBegin = line.find_first_not_of(" \t", separator + 1);
+		size_t valueEnd = line.find_last_not_of(" \t\r");
+		arguments.push_back(valueBegin == string::npos ? string() : line.substr(valueBegin, valueEnd - valueBegin + 1));
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const char* batchPath = nullptr;
+	const char* serverAddress = nullptr;
+	vector<const char*> pluginPaths;
+	const char* formula = nullptr;
+	const char* columnarInput = nullptr;
+	const char* columnarOutput = nullptr;
+	const char* metricsPath = nullptr;
+	bool metricsJson = false;
+	size_t benchmarkRepetitions = 0;
+	size_t numberOfThreads = 1;
+	size_t cacheCapacity = 0;
+	NumberBackend numbers = NUMBERS_DOUBLE;
+	bool fastMath = false;
+	ColumnDevice device = COLUMN_DEVICE_CPU;
+	vector<string> workers;
+	const char* calculatorName = nullptr;
+	const char* operationSymbols = nullptr;
+	const char* tapeCachePath = nullptr;
+	bool aggregating = false;
+	bool selfTesting = false;
+	vector<string> arguments;
+	for(int i = 1; i < argc; i++)
+	{
+		if(string(argv[i]) == "--config" && i + 1 < argc) readConfiguration(argv[++i], arguments);
+		else arguments.push_back(argv[i]);
+	}
+	for(size_t i = 0; i < arguments.size(); i++)
+	{
+		const string& argument = arguments[i];
+		if(argument == "--batch" && i + 1 < arguments.size()) batchPath = arguments[++i].c_str();
+		else if(argument == "--workers" && i + 1 < arguments.size())
+		{
+			stringstream list(arguments[++i].c_str());
+			string worker;
+			while(getline(list, worker, ',')) if(!worker.empty()) workers.push_back(worker);
+		}
+		else if(argument == "--aggregate") aggregating = true;
+		else if(argument == "--threads" && i + 1 < arguments.size()) numberOfThreads = strtoul(arguments[++i].c_str(), nullptr, 10);
+		else if(argument == "--server" && i + 1 < arguments.size()) serverAddress = arguments[++i].c_str();
+		else if(argument == "--cache" && i + 1 < arguments.size()) cacheCapacity = strtoul(arguments[++i].c_str(), nullptr, 10);
+		else if(argument == "--metrics" && i + 1 < arguments.size()) metricsPath = arguments[++i].c_str();
+		else if(argument == "--metrics-format" && i + 1 < arguments.size()) metricsJson = string(arguments[++i].c_str()) == "json";
+		else if(argument == "--formula" && i + 1 < arguments.size()) formula = arguments[++i].c_str();
+		else if(argument == "--columnar-input" && i + 1 < arguments.size()) columnarInput = arguments[++i].c_str();
+		else if(argument == "--columnar-output" && i + 1 < arguments.size()) columnarOutput = arguments[++i].c_str();
+		else if(argument == "--fast-math") fastMath = true;
+		else if(argument == "--device" && i + 1 < arguments.size()) device = parseColumnDevice(arguments[++i].c_str());
+		else if(argument == "--numbers" && i + 1 < arguments.size()) numbers = parseNumberBackend(arguments[++i].c_str());
+		else if(argument == "--plugin" && i + 1 < arguments.size()) pluginPaths.push_back(arguments[++i].c_str());
+		else if(argument == "--name" && i + 1 < arguments.size()) calculatorName = arguments[++i].c_str();
+		else if(argument == "--operations" && i + 1 < arguments.size()) operationSymbols = arguments[++i].c_str();
+		else if(argument == "--tape-cache" && i + 1 < arguments.size()) tapeCachePath = arguments[++i].c_str();
+		else if(argument == "--self-test") selfTesting = true;
+		else if(argument == "--benchmark") benchmarkRepetitions = BENCHMARK_REPETITIONS;
+		else if(argument == "--repetitions" && i + 1 < arguments.size()) benchmarkRepetitions = strtoul(arguments[++i].c_str(), nullptr, 10);
+		else throwException("Usage: calculator [--batch <file|-> [--workers <address>[,<address>]...] [--aggregate] | --formula <expression> --columnar-input <file|-> [--columnar-output <file|->] [--fast-math] [--device cpu|opencl|auto] [--tape-cache <file>] | --server <tcp:[host:]port|unix:path> | --benchmark [--repetitions <n>] | --self-test] [--plugin <library>]... [--threads <n>] [--cache <entries>] [--numbers double|fixed|decimal128|big] [--metrics <file|-> [--metrics-format prometheus|json]] [--name <name> --operations <symbols>] [--config <file>]");
+	}
+	OperationRegistry& registry = OperationRegistry::global();
+	for(const char* path : pluginPaths)
+	{
+		registry.loadPlugin(path);
+	}
+	if(formula != nullptr || columnarInput != nullptr)
+	{
+		if(formula == nullptr || columnarInput == nullptr) throwException("Columnar mode needs both --formula and --columnar-input!");
+		return runColumnarMode(formula, columnarInput, columnarOutput, numberOfThreads, fastMath, device, tapeCachePath);
+	}
+	if(selfTesting) return runSelfTestMode();
+	if(benchmarkRepetitions != 0) return runBenchmarkMode(benchmarkRepetitions);
+	if(serverAddress != nullptr) return runServerMode(serverAddress, numberOfThreads, cacheCapacity, metricsPath, metricsJson, numbers);
+	if(batchPath != nullptr && !workers.empty()) return runCoordinatorMode(batchPath, workers, aggregating, numbers);
+	if(batchPath != nullptr) return runBatchMode(batchPath, numberOfThreads, cacheCapacity, metricsPath, metricsJson, numbers, aggregating);
+	char name[MAX_NAME_LENGTH + 1];
+	vector<string> operationList;
+	if(calculatorName != nullptr)
+	{
+		strncpy(name, calculatorName, MAX_NAME_LENGTH);
+		name[MAX_NAME_LENGTH] = '\0';
+	}
+	else
+	{
+		cout << "Enter calculator's name: ";
+		cin.getline(name, MAX_NAME_LENGTH + 1);
+	}
+	if(operationSymbols != nullptr)
+	{
+		stringstream list(operationSymbols);
+		string operationSymbol;
+		while(list >> operationSymbol)
+		{
+			if(registry.find(operationSymbol) == nullptr) throwException("Invalid operator!");
+			operationList.push_back(operationSymbol);
+		}
+	}
+	else
+	{
+		size_t numberOfOperations;
+		do
+		{
+			cout << "Enter number of operations: ";
+			cin >> numberOfOperations;
+			if(cin.fail())
+			{
+				cout << "Couldn't convert to number!" << endl;
+			
+			}
+			else break;
+			cin.clear();
+			cin.ignore(numeric_limits<streamsize>::max(), '\n');
+		} while(true);
+	
+		cout << "Enter operations: " << endl;
+		for(size_t i = 0; i < registry.size(); i++)
+		{
+			cout << registry[i].getSymbol() << " - " << registry[i].getName() << endl;
+		}
+		operationList.resize(numberOfOperations);
+		while(true)
+		{
+			string operationSymbol;
+			bool valid = true;
+			for(size_t i = 0; i < numberOfOperations; i++)
+			{
+				cin >> operationSymbol;
+				if(registry.find(operationSymbol) != nullptr)
+				{
+					operationList[i] = operationSymbol;
+				}
+				else
+				{
+					cout << "Invalid operator!" << endl;
+					valid = false;
+					break;
+				}
+			}
+			cin.clear();
+			cin.ignore(numeric_limits<streamsize>::max(), '\n');
+			if(valid) break;
+		}
+	}
+	
+	Calculator calc(name);
+	for(size_t i = 0; i < operationList.size(); i++)
+	{
+		calc.addOperation(operationList[i]);
+	}
+	while(true)
+	{
+		cout << "1. List supported operations" << endl;
+		cout << "2. List input format" << endl;
+		cout << "3. Start calculation" << endl;
+		cout << "4. Exit" << endl;
+		short chosenOption;
+		cin >> chosenOption;
+		switch(chosenOption)
+		{
+		case 1:
+			calc.listSupportedOperations();
+			break;
+		case 2:
+			calc.listInputFormat();
+			break;
+		case 3:
+			calc.startCalculation();
+			break;
+		case 4:
+			break;
+		default:
+			cout << "Invalid option, try again." << endl;
+			cin.clear();
+			cin.ignore(numeric_limits<streamsize>::max(), '\n');
+		}
+		if(chosenOption == 4) break;
+	}
+	return 0;
+}